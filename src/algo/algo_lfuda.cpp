@@ -100,7 +100,7 @@ void LFUDA::remove_cache(size_t required){
     }
     
     if(cache_map.empty())std::cerr << "no cache remained" << std::endl;
-    if(removed.size())remove_callback(removed);
+    if(removed.size())remove_callback(std::move(removed));
 }
 
 LFUDA::Iter LFUDA::update_size(Iter it, size_t size){
@@ -132,3 +132,10 @@ LFUDA::Cache LFUDA::query(const std::string& key) const{
     if(it == cache_map.end())return {};
     return *it->second;
 }
+
+std::vector<std::string> LFUDA::keys() const{
+    std::vector<std::string> res;
+    res.reserve(cache_map.size());
+    for(auto& it : cache_map)res.push_back(it.first);
+    return res;
+}
@@ -40,7 +40,7 @@ public:
         }
     };
     using Iter = std::set<Cache>::iterator;
-    using RemoveCallback = std::function<void(std::vector<Cache>)>;
+    using RemoveCallback = std::function<void(std::vector<Cache>&&)>; //the batch is handed over
     
     LFUDA(size_t size, RemoveCallback cb);
     ~LFUDA() = default;
@@ -52,6 +52,7 @@ public:
     void resize(size_t new_size);
     void display() const;
     Cache query(const std::string& key) const;
+    std::vector<std::string> keys() const;     //snapshot, e.g. for the GC
 
 private:
     size_t max_size, cache_size;
@@ -31,7 +31,7 @@ class LFUDA{
 public:
     using Cache = SQLiteLFUDA::CacheLFUDA;
     using Meta = SQLiteLFUDA::MetaLFUDA;
-    using RemoveCallback = std::function<void(std::vector<Cache>)>;
+    using RemoveCallback = std::function<void(std::vector<Cache>&&)>; //the batch is handed over
     
     LFUDA(std::shared_ptr<SQLiteLFUDA> db, RemoveCallback cb);
     ~LFUDA();
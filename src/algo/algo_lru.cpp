@@ -69,7 +69,7 @@ bool LRU::put(const Cache& cache){
  * It was very important that you shoule configure the "hash key" very carefully,
  * as it is the only standard to differ the caches.
  *
- * Every cache marked as duplicated will be cleared by GC Process!
+ * Every cache marked as duplicated will be cleared by GC Process! (CacheGC)
  */
 
 bool LRU::renew(const std::string& key){
@@ -86,7 +86,7 @@ bool LRU::renew(const std::string& key){
 
 bool LRU::update(const std::string& key, size_t size){
     auto it = cache_map.find(key);
-    if(it == cache_map.end()){
+    if(it != cache_map.end()){
         if(size != it->second->size){
             update_size(it->second, size);
         }
@@ -110,12 +110,12 @@ void LRU::remove_cache(size_t required){
         del_it--;
         cache_map.erase(del_it->key);
         cache_size -= del_it->size;
-        removed.push_back(*del_it);
+        removed.push_back(std::move(*del_it));
         cache_list.pop_back();
     }
 
     if(cache_map.empty())std::cerr << "no cache remained" << std::endl;
-    if(removed.size())remove_callback(removed);
+    if(removed.size())remove_callback(std::move(removed));
 }
 
 void LRU::update_size(Iter it, size_t size){
@@ -140,3 +140,10 @@ LRU::Cache LRU::query(const std::string& key) const{
     if(it == cache_map.end())return {};
     return *it->second;
 }
+
+std::vector<std::string> LRU::keys() const{
+    std::vector<std::string> res;
+    res.reserve(cache_map.size());
+    for(auto& it : cache_map)res.push_back(it.first);
+    return res;
+}
@@ -21,7 +21,7 @@ public:
         uint64_t download_time;
         std::vector<char> hash;
     };
-    using RemoveCallback = std::function<void(std::vector<Cache>)>;
+    using RemoveCallback = std::function<void(std::vector<Cache>&&)>; //the batch is handed over
     using Iter = std::list<Cache>::iterator;
     LRU(size_t size, RemoveCallback cb);
     ~LRU() = default;
@@ -33,6 +33,7 @@ public:
     bool update(const std::string& key, size_t size);
     void resize(size_t new_size);
     Cache query(const std::string& key) const;
+    std::vector<std::string> keys() const;     //snapshot, e.g. for the GC
     void display() const;
 
 private:
@@ -148,23 +148,22 @@ bool LRU::remove_cache(size_t required, const std::string& mark){
         auto entry = db_sqlite->delete_lru_old();
         
         if(entry.key.empty()){
-            if(removed.size())remove_callback(removed);
+            if(removed.size())remove_callback(std::move(removed));
             throw AlgoErrorLRU("db error: cache_size mismatch or cache with empty key");
         }
 
+        flag |= (entry.key == mark);
         if(meta_lru.cache_size >= entry.size){
             meta_lru.cache_size -= entry.size;
-            removed.push_back(entry);
+            removed.push_back(std::move(entry));
         }else{
-            removed.push_back(entry);
-            remove_callback(removed);
+            removed.push_back(std::move(entry));
+            remove_callback(std::move(removed));
             throw AlgoErrorLRU("db error: cache_size mismatch");
         }
-        
-        flag |= (entry.key == mark);
     }
 
-    if(removed.size())remove_callback(removed);
+    if(removed.size())remove_callback(std::move(removed));
     return flag;
 }
 
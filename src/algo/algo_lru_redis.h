@@ -18,7 +18,7 @@ class LRU{
 public:
     using Cache = SQLiteLRU::CacheLRU;
     using Meta = SQLiteLRU::MetaLRU;
-    using RemoveCallback = std::function<void(std::vector<Cache>)>;
+    using RemoveCallback = std::function<void(std::vector<Cache>&&)>; //the batch is handed over
     
     LRU(std::shared_ptr<SQLiteLRU> db, RemoveCallback cb);
     ~LRU();
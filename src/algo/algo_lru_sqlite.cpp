@@ -42,6 +42,46 @@ void LRU::init(){ //data validation should be performed before LRU
     << meta_lru.max_size << ", " << meta_lru.sequence << std::endl;
 }
 
+/*
+ * Apply the differences with the cache directory (see Reconciler) in one
+ * transaction: the rows without a file are dropped, the sizes are set to
+ * the bytes on disk, and the files nobody tracked are inserted before
+ * the oldest row, so they are the first to go. cache_size is summed from
+ * the rows and the sequence follows the newest row, so init() passes.
+ */
+void LRU::reconcile(const std::vector<std::string>& phantoms,
+                    const std::vector<std::pair<std::string, size_t>>& resized,
+                    const std::vector<Cache>& untracked){
+    meta_lru = db_sqlite->query_meta();
+    db_sqlite->begin();
+    try{
+        for(auto& it : phantoms)db_sqlite->delete_lru_key(it);
+        for(auto& [key, size] : resized)db_sqlite->update_lru_content(key, size);
+
+        auto oldest = db_sqlite->query_lru_old();
+        int64_t sequence = oldest.key.empty() ? meta_lru.sequence + 1 :
+                           oldest.sequence - static_cast<int64_t>(untracked.size());
+        for(auto& it : untracked){
+            if(it.key.empty() || it.size == 0)continue;
+            Cache tmp = it;
+            tmp.sequence = sequence++;
+            db_sqlite->insert_lru(tmp);
+        }
+
+        auto newest = db_sqlite->query_lru_new();
+        if(newest.key.size())meta_lru.sequence = newest.sequence;
+        meta_lru.cache_size = db_sqlite->query_lru_size();
+        db_sqlite->update_meta(meta_lru);
+        db_sqlite->commit();
+    }catch(const std::exception& e){
+        db_sqlite->rollback();
+        throw;
+    }
+
+    std::cerr << "reconciled: " << phantoms.size() << " dropped, " << resized.size() << " resized, "
+    << untracked.size() << " added, cache_size: " << meta_lru.cache_size << std::endl;
+}
+
 void LRU::backup() const{
     db_sqlite->update_meta(meta_lru);
 }
@@ -148,23 +188,22 @@ bool LRU::remove_cache(size_t required, const std::string& mark){
         auto entry = db_sqlite->delete_lru_old();
         
         if(entry.key.empty()){
-            if(removed.size())remove_callback(removed);
+            if(removed.size())remove_callback(std::move(removed));
             throw AlgoErrorLRU("db error: cache_size mismatch or cache with empty key");
         }
 
+        flag |= (entry.key == mark);
         if(meta_lru.cache_size >= entry.size){
             meta_lru.cache_size -= entry.size;
-            removed.push_back(entry);
+            removed.push_back(std::move(entry));
         }else{
-            removed.push_back(entry);
-            remove_callback(removed);
+            removed.push_back(std::move(entry));
+            remove_callback(std::move(removed));
             throw AlgoErrorLRU("db error: cache_size mismatch");
         }
-        
-        flag |= (entry.key == mark);
     }
 
-    if(removed.size())remove_callback(removed);
+    if(removed.size())remove_callback(std::move(removed));
     return flag;
 }
 
@@ -20,12 +20,15 @@ class LRU{
 public:
     using Cache = SQLiteLRU::CacheLRU;
     using Meta = SQLiteLRU::MetaLRU;
-    using RemoveCallback = std::function<void(std::vector<Cache>)>;
+    using RemoveCallback = std::function<void(std::vector<Cache>&&)>; //the batch is handed over
     
     LRU(std::shared_ptr<SQLiteLRU> db, RemoveCallback cb);
     ~LRU();
     
     void init();
+    void reconcile(const std::vector<std::string>& phantoms,
+                   const std::vector<std::pair<std::string, size_t>>& resized,
+                   const std::vector<Cache>& untracked);   //oldest first
     void backup() const;
     bool put(const Cache& cache);
     bool renew(const std::string& key);
@@ -1,7 +1,20 @@
+#ifndef DB_REDIS_LRU_H
+#define DB_REDIS_LRU_H
+
 #include "redis_base.h"
 #include "redis_adapter.h"
 #include <optional>
+#include <span>
 #include <variant>
+#include <vector>
+
+/*
+ * Every entry is mirrored into the size index (a hash without TTL),
+ * so the size of a key is still known after the server evicts it.
+ * Run redis with a volatile-* maxmemory-policy, otherwise the index
+ * itself may be evicted.
+ */
+#define LRU_SIZE_INDEX "lru_size"
 
 class RedisLRU{
 public:
@@ -54,13 +67,78 @@ public:
    
     bool insert_lru(const CacheLRU& entry){
         std::string serial = RedisAdapter::serialize(entry.size, entry.download_time, entry.hash);
-        auto res = redis->command_single<Int>("EXISTS %s", entry.key);
+        auto res = redis->command_single<Int>("EXISTS %s", entry.key.c_str());
         check_error(res);
-        return check_value<Int>(res, 0);
+        if(!check_value<Int>(res, 0))return false;
 
-        auto res2 = redis->command_single<Int>("HSET %s %s", entry.key, serial);
-        check_error(res2);
-        return check_value<Int>(res2, 1);
+        auto res2 = redis->command_multi_argv<Status>({"SET", entry.key, serial});
+        check_error(res2.front());
+        
+        auto res3 = redis->command_multi_argv<Int>({"HSET", LRU_SIZE_INDEX, entry.key,
+                                                   std::to_string(entry.size)});
+        check_error(res3.front());
+        return check_value<Int>(res3.front(), 1);
+    }
+
+    //the keys are already evicted by redis, drop them from the size index
+    //and reconcile cache_size in meta, return the entries we knew about
+    std::vector<CacheLRU> delete_lru_evicted(std::span<const std::string> keys){
+        std::vector<CacheLRU> removed;
+        if(keys.empty())return removed;
+
+        std::vector<std::string> argv;
+        argv.reserve(keys.size() + 2);
+        argv.emplace_back("HMGET");
+        argv.emplace_back(LRU_SIZE_INDEX);
+        argv.insert(argv.end(), keys.begin(), keys.end());
+        
+        auto sizes = redis->command_multi_argv<String>(argv);
+        if(sizes.size() != keys.size()){
+            check_error(sizes.front());
+            throw RedisError("size index reply mismatch");
+        }
+
+        size_t freed = 0;
+        for(size_t i = 0; i < keys.size(); i++){
+            check_error(sizes[i]);
+            if(auto *ptr = std::get_if<String>(&sizes[i])){
+                size_t size = std::stoull(ptr->str);
+                freed += size;
+                removed.emplace_back(keys[i], size, 0, "");
+            }
+        }//nil: unknown to us (or reconciled already)
+        
+        if(removed.empty())return removed;
+        
+        argv[0] = "HDEL";
+        auto res = redis->command_multi_argv<Int>(argv);
+        check_error(res.front());
+
+        auto res2 = redis->command_multi_argv<Int>({"HINCRBY", "lru_meta", "cache_size",
+                                                   '-' + std::to_string(freed)});
+        check_error(res2.front());
+        if(auto *ptr = std::get_if<Int>(&res2.front()); ptr && ptr->val < 0){
+            logger->put_error(LOG_ZONE_LRU_REDIS, "cache_size underflow after reconciling: ",
+                              ptr->val);
+        }
+
+        return removed;
+    }
+
+    size_t query_cache_size(){
+        auto res = redis->command_single<String>("HGET lru_meta cache_size");
+        check_error(res);
+        if(auto *ptr = std::get_if<String>(&res))return std::stoull(ptr->str);
+        throw RedisError("meta not found");
+    }
+
+    static std::optional<CacheLRU> deserialize_lru(const std::string& key,
+                                                   const std::string& raw){
+        size_t size;
+        uint64_t download_time;
+        std::string hash;
+        if(!RedisAdapter::deserialize(raw, size, download_time, hash))return std::nullopt;
+        return CacheLRU(key, size, download_time, hash);
     }
 
     int update_lru(const CacheLRU& entry){
@@ -95,3 +173,5 @@ private:
     
    
 };
+
+#endif
@@ -0,0 +1,203 @@
+/*
+ * Warm start for the redis backend
+ * Walk the whole keyspace once on startup, so the local indexes
+ * (bloom filter, size histogram, ...) can be rebuilt and cache_size
+ * can be verified against the sum of entry sizes.
+ *
+ * Every MATCH pattern gets its own SCAN cursor on its own connection
+ * (hiredis context is not thread-safe), the values of each batch are
+ * fetched with one pipelined round trip and deserialized on the worker
+ * pool. COUNT is tuned on the fly: grown while the replies are fast and
+ * sparse, shrunk when a single step takes too long.
+ *
+ * One cursor can't be split safely (SCAN may step over the boundary of
+ * any bucket range and return the keys twice), so use one pattern per
+ * key prefix to scan in parallel.
+ */
+
+#ifndef DB_REDIS_WARMUP_H
+#define DB_REDIS_WARMUP_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "db_redis_lru.h"
+
+#define WARM_COUNT_MIN   100
+#define WARM_COUNT_MAX   10000
+#define WARM_STEP_TIME   50    //ms, target time of one SCAN step
+#define WARM_QUEUE_MAX   64    //batches waiting for deserializing
+
+class RedisWarmUp{
+public:
+    using Cache = RedisLRU::CacheLRU;
+    using ConnFactory = std::function<std::shared_ptr<RedisAdapter>()>;
+    using BatchCallback = std::function<void(std::vector<Cache>& batch)>;
+    //called from the worker threads concurrently, must be thread-safe
+
+    struct Report{
+        size_t keys, entries, broken, total_size;
+        double seconds, keys_per_sec;
+    };
+
+    RedisWarmUp(const std::shared_ptr<Logger>& logger, ConnFactory factory,
+                const std::vector<std::string>& patterns = {"*"},
+                size_t workers = 4, size_t count = 1000) :
+                logger(logger), factory(factory), patterns(patterns),
+                workers(workers), init_count(std::clamp<size_t>(count,
+                WARM_COUNT_MIN, WARM_COUNT_MAX)){
+        if(patterns.empty() || workers == 0)throw RedisError("warm up: invalid args");
+    }
+
+    Report run(BatchCallback cb){
+        auto start = std::chrono::steady_clock::now();
+        callback = cb;
+        keys = entries = broken = total_size = 0;
+        scanners_left = patterns.size();
+        failed = false;
+
+        std::vector<std::thread> pool;
+        for(size_t i = 0; i < workers; i++){
+            pool.emplace_back(&RedisWarmUp::worker, this);
+        }
+        std::vector<std::thread> scanners;
+        for(auto& it : patterns){
+            scanners.emplace_back(&RedisWarmUp::scanner, this, it);
+        }
+
+        for(auto& it : scanners)it.join();
+        for(auto& it : pool)it.join();
+        if(failed)throw RedisError("warm up: scanner failed");
+
+        double seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start).count();
+        Report report = {keys, entries, broken, total_size, seconds,
+                         seconds > 0 ? keys / seconds : 0};
+        logger->put_info(LOG_ZONE_LRU_REDIS, "warm up finished: ", report.keys,
+                         " keys (", report.broken, " broken) in ", report.seconds,
+                         "s, ", static_cast<size_t>(report.keys_per_sec), " keys/s");
+        return report;
+    }
+
+    //compare the sum of entry sizes with meta (after run)
+    bool verify(const std::shared_ptr<RedisAdapter>& redis, const Report& report){
+        RedisLRU db_redis(logger, redis);
+        size_t cache_size = db_redis.query_cache_size();
+        if(cache_size == report.total_size)return true;
+        logger->put_warn(LOG_ZONE_LRU_REDIS, "cache_size mismatch: meta: ", cache_size,
+                         ", scanned: ", report.total_size);
+        return false;
+    }
+
+private:
+    using RawBatch = std::vector<std::pair<std::string, std::string>>;
+
+    std::shared_ptr<Logger> logger;
+    ConnFactory factory;
+    const std::vector<std::string> patterns;
+    const size_t workers, init_count;
+    BatchCallback callback;
+
+    std::queue<RawBatch> batch_queue;
+    std::mutex queue_lock;
+    std::condition_variable queue_cv, space_cv;
+    size_t scanners_left;
+    std::atomic<bool> failed;
+    std::atomic<size_t> keys, entries, broken, total_size;
+
+    void scanner(const std::string pattern){
+        try{
+            auto redis = factory();
+            std::string cursor = "0";
+            size_t count = init_count;
+            std::vector<std::string> batch_keys;
+            std::vector<std::vector<std::string>> cmds;
+
+            do{
+                auto step = std::chrono::steady_clock::now();
+                cursor = redis->scan(cursor, pattern, count, batch_keys, "string");
+                auto cost = std::chrono::steady_clock::now() - step;
+
+                if(cost > std::chrono::milliseconds(WARM_STEP_TIME)){
+                    count = std::max<size_t>(count / 2, WARM_COUNT_MIN);
+                }else if(batch_keys.size() < count / 2){
+                    count = std::min<size_t>(count * 2, WARM_COUNT_MAX);
+                }//few matches for a cheap step, ask for more buckets next time
+
+                if(batch_keys.empty())continue;
+                keys.fetch_add(batch_keys.size());
+
+                cmds.resize(batch_keys.size());
+                for(size_t i = 0; i < batch_keys.size(); i++){
+                    cmds[i] = {"GET", batch_keys[i]};
+                }
+                auto values = redis->pipeline_single<RedisAdapter::RedisReplyString>(cmds);
+
+                RawBatch raw;
+                raw.reserve(values.size());
+                for(size_t i = 0; i < values.size(); i++){
+                    if(auto *ptr = std::get_if<RedisAdapter::RedisReplyString>(&values[i])){
+                        raw.emplace_back(std::move(batch_keys[i]), std::move(ptr->str));
+                    }
+                }//nil: expired or evicted between SCAN and GET
+
+                std::unique_lock<std::mutex> lock(queue_lock);
+                space_cv.wait(lock, [this]{return batch_queue.size() < WARM_QUEUE_MAX;});
+                batch_queue.push(std::move(raw));
+                lock.unlock();
+                queue_cv.notify_one();
+            }while(cursor != "0");
+        }catch(const std::exception& e){
+            logger->put_error(LOG_ZONE_LRU_REDIS, "warm up scanner (", pattern, "): ", e.what());
+            failed = true;
+        }
+
+        std::unique_lock<std::mutex> lock(queue_lock);
+        scanners_left--;
+        lock.unlock();
+        queue_cv.notify_all();
+    }
+
+    void worker(){
+        std::vector<Cache> batch;
+        while(true){
+            std::unique_lock<std::mutex> lock(queue_lock);
+            queue_cv.wait(lock, [this]{return batch_queue.size() || scanners_left == 0;});
+            if(batch_queue.empty())return;
+
+            RawBatch raw = std::move(batch_queue.front());
+            batch_queue.pop();
+            lock.unlock();
+            space_cv.notify_one();
+
+            batch.clear();
+            size_t sum = 0;
+            for(auto& it : raw){
+                auto entry = RedisLRU::deserialize_lru(it.first, it.second);
+                if(!entry.has_value()){
+                    broken.fetch_add(1);
+                    logger->put_warn(LOG_ZONE_LRU_REDIS, "warm up: broken entry: ", it.first);
+                    continue;
+                }
+                sum += entry->size;
+                batch.push_back(std::move(entry.value()));
+            }
+
+            entries.fetch_add(batch.size());
+            total_size.fetch_add(sum);
+            if(batch.size() && callback)callback(batch);
+        }
+    }
+};
+
+#endif
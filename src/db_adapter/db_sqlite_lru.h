@@ -115,6 +115,31 @@ public:
         return std::make_from_tuple<CacheLRU>(raw_entry);
     }
    
+    std::vector<std::tuple<std::string, size_t>> query_lru_keys(){ //key, size, sorted by key
+        return query_multi<std::string, size_t>(SQL_QUERY_KEYS_LRU);
+    }
+
+    size_t query_lru_size(){                   //sum of the sizes
+        return std::get<0>(query_single<size_t>(SQL_QUERY_SIZE_LRU));
+    }
+
+    int delete_lru_key(const std::string& key){
+        return execute(SQL_DELETE_KEY_LRU, key);
+    }
+
+    //bulk changes, one transaction instead of one per statement
+    void begin(){
+        execute(SQL_BEGIN);
+    }
+
+    void commit(){
+        execute(SQL_COMMIT);
+    }
+
+    void rollback(){
+        execute_noexcept(SQL_ROLLBACK);
+    }
+
     CacheLRU delete_lru_old(){
         auto raw_entry = query_single<std::string, size_t,
                                       uint64_t, std::vector<char>,
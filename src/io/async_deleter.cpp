@@ -1,8 +1,11 @@
 #include "async_deleter.h"
 #include <filesystem>
 
-AsyncDeleter::AsyncDeleter(size_t thr, FailCallback cb) : threads(thr),
-fail_callback(cb), running_threads(0), working_jobs(0), work_guard(nullptr) {}
+AsyncDeleter::AsyncDeleter(size_t thr, FailCallback cb, bool uring) : threads(thr),
+fail_callback(cb), running_threads(0), working_jobs(0), work_guard(nullptr),
+use_uring(uring && Uring::supported({IORING_OP_STATX, IORING_OP_UNLINKAT})){
+    if(uring && !use_uring)std::cerr << "warning: io_uring unavailable, using the thread pool" << std::endl;
+}
 
 AsyncDeleter::~AsyncDeleter(){
     force_stop();
@@ -39,6 +42,7 @@ void AsyncDeleter::run(){
 }
 
 void AsyncDeleter::force_stop(){
+    set_budget(0, 0);                      //wake the throttled threads
     work_guard->reset();
     size_t jobs = working_jobs;
     if(jobs)std::cerr << "warning: " << jobs << " working jobs, force stop" << std::endl;
@@ -57,25 +61,286 @@ void AsyncDeleter::stop(){
     wait_thread();
 }
 
-void AsyncDeleter::submit(const std::string& file){
-    working_jobs.fetch_add(1);
-    asio::post(io, [this, file](){
-            std::error_code ec;
-            try{
-                if(!fs::remove_all(file, ec)){
-                    fail_callback(file, ec);
-                }
-            }catch(const std::exception& e){
-                std::cerr << "exception: " << e.what() << std::endl;
+void AsyncDeleter::finish_job(uint64_t size){
+    if(size)pending.fetch_sub(size, std::memory_order_relaxed);
+    if(working_jobs.fetch_sub(1) <= 2){
+        std::unique_lock<std::mutex> mtx(cv_lock);
+        cv.notify_all();
+    }
+}
+
+void AsyncDeleter::remove_file(const std::string& file, uint64_t size){
+    std::error_code ec;
+    try{
+        struct stat st;
+        uint64_t bytes = lstat(file.c_str(), &st) == 0 && !S_ISDIR(st.st_mode) ? st.st_blocks * 512 : 0;
+        throttle(bytes ? bytes : size);
+        if(!fs::remove_all(file, ec)){
+            fail_callback(file, ec);
+        }else{
+            freed_files.fetch_add(1, std::memory_order_relaxed);
+            freed_bytes.fetch_add(bytes, std::memory_order_relaxed);
+        }
+    }catch(const std::exception& e){
+        std::cerr << "exception: " << e.what() << std::endl;
+    }
+    finish_job(size);
+}
+
+/*
+ * One directory of a batch: the names are resolved relative to a single
+ * dirfd instead of walking the full path for every file, and unlinked in
+ * inode order (the inode table is read and written mostly sequentially).
+ * Directories are left to remove_all, like submit(), and so is a
+ * directory with a single file.
+ */
+void AsyncDeleter::remove_dir_batch(DirBatch& batch){
+    if(batch.names.size() == 1){           //a dirfd would only add the open and close
+        remove_file(batch.dir + '/' + batch.names[0], batch.sizes[0]);
+        return;
+    }
+    int dir_fd = open(batch.dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if(dir_fd < 0){
+        std::error_code ec(errno, std::system_category());
+        for(size_t i = 0; i < batch.names.size(); i++){
+            fail_callback(batch.dir + '/' + batch.names[i], ec);
+            finish_job(batch.sizes[i]);
+        }
+        return;
+    }
+
+    struct Entry{
+        ino_t ino;
+        uint64_t bytes;
+        size_t index;
+    };
+    std::vector<Entry> entries;
+    entries.reserve(batch.names.size());
+    for(size_t i = 0; i < batch.names.size(); i++){
+        struct stat st;
+        if(fstatat(dir_fd, batch.names[i].c_str(), &st, AT_SYMLINK_NOFOLLOW)){
+            fail_callback(batch.dir + '/' + batch.names[i], std::error_code(errno, std::system_category()));
+            finish_job(batch.sizes[i]);
+            continue;
+        }
+        if(S_ISDIR(st.st_mode)){
+            remove_file(batch.dir + '/' + batch.names[i], batch.sizes[i]);
+            continue;
+        }
+        entries.push_back({st.st_ino, static_cast<uint64_t>(st.st_blocks) * 512, i});
+    }
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b){return a.ino < b.ino;});
+
+    for(auto& it : entries){
+        throttle(it.bytes);
+        if(unlinkat(dir_fd, batch.names[it.index].c_str(), 0)){
+            fail_callback(batch.dir + '/' + batch.names[it.index], std::error_code(errno, std::system_category()));
+        }else{
+            freed_files.fetch_add(1, std::memory_order_relaxed);
+            freed_bytes.fetch_add(it.bytes, std::memory_order_relaxed);
+        }
+        finish_job(batch.sizes[it.index]);
+    }
+    close(dir_fd);
+}
+
+/*
+ * The same with io_uring: statx for every file, then unlinkat in inode
+ * order, each stage keeping the ring full. Full paths (AT_FDCWD), the
+ * path walk is done in the kernel and the dirfds would cost syscalls.
+ */
+void AsyncDeleter::remove_batch_uring(std::vector<DirBatch>& batch){
+    thread_local std::unique_ptr<Uring> ring;
+    if(!ring){
+        try{
+            ring = std::make_unique<Uring>(URING_DEPTH);
+        }catch(const std::exception& e){
+            std::cerr << "exception: " << e.what() << std::endl;
+            for(auto& dir : batch)remove_dir_batch(dir);
+            return;
+        }
+    }
+
+    struct Entry{
+        std::string path;
+        uint64_t size;
+        struct statx stx;
+    };
+    std::vector<Entry> entries;
+    for(auto& dir : batch){
+        for(size_t i = 0; i < dir.names.size(); i++)entries.push_back({dir.dir + '/' + dir.names[i], dir.sizes[i], {}});
+    }
+
+    //keeps up to depth() operations in flight until all n are completed
+    auto run = [this](size_t n, const std::function<void(size_t, io_uring_sqe*)>& prep,
+                      const std::function<void(size_t, int)>& complete){
+        size_t next = 0, inflight = 0;
+        std::vector<bool> completed(n, false);
+        io_uring_cqe cqe;
+        while(next < n || inflight){
+            io_uring_sqe* sqe;
+            while(next < n && (sqe = ring->get_sqe()) != nullptr){
+                prep(next, sqe);
+                sqe->user_data = next++;
+                inflight++;
             }
-            
-            if(working_jobs.fetch_sub(1) <= 2){
-                std::unique_lock<std::mutex> mtx(cv_lock);
-                cv.notify_all();
+            int res = ring->submit(1);
+            if(res < 0 && res != -EAGAIN && res != -EBUSY){
+                //the ring is dropped with what is in flight, everything left fails
+                std::cerr << "uring: enter: " << strerror(-res) << std::endl;
+                ring.reset();
+                for(size_t i = 0; i < n; i++)if(!completed[i])complete(i, res);
+                return;
             }
+            while(ring->peek(cqe)){
+                completed[cqe.user_data] = true;
+                complete(cqe.user_data, cqe.res);
+                inflight--;
+            }
+        }
+    };
+    std::vector<size_t> order;
+    order.reserve(entries.size());
+    run(entries.size(), [&](size_t i, io_uring_sqe* sqe){
+        sqe->opcode = IORING_OP_STATX;
+        sqe->fd = AT_FDCWD;
+        sqe->addr = reinterpret_cast<uint64_t>(entries[i].path.c_str());
+        sqe->len = STATX_TYPE | STATX_INO | STATX_BLOCKS;
+        sqe->statx_flags = AT_SYMLINK_NOFOLLOW;
+        sqe->off = reinterpret_cast<uint64_t>(&entries[i].stx);
+    }, [&](size_t i, int res){
+        if(res < 0){
+            fail_callback(entries[i].path, std::error_code(-res, std::system_category()));
+            finish_job(entries[i].size);
+        }else if(S_ISDIR(entries[i].stx.stx_mode)){
+            remove_file(entries[i].path, entries[i].size);
+        }else{
+            order.push_back(i);
+        }
+    });
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b){
+        return entries[a].stx.stx_ino < entries[b].stx.stx_ino;
+    });
+
+    if(!ring){                             //failed in the statx stage
+        for(auto i : order){
+            fail_callback(entries[i].path, std::error_code(EIO, std::system_category()));
+            finish_job(entries[i].size);
+        }
+        return;
+    }
+    run(order.size(), [&](size_t i, io_uring_sqe* sqe){
+        throttle(entries[order[i]].stx.stx_blocks * 512);
+        sqe->opcode = IORING_OP_UNLINKAT;
+        sqe->fd = AT_FDCWD;
+        sqe->addr = reinterpret_cast<uint64_t>(entries[order[i]].path.c_str());
+    }, [&](size_t i, int res){
+        auto& entry = entries[order[i]];
+        if(res < 0){
+            fail_callback(entry.path, std::error_code(-res, std::system_category()));
+        }else{
+            freed_files.fetch_add(1, std::memory_order_relaxed);
+            freed_bytes.fetch_add(entry.stx.stx_blocks * 512, std::memory_order_relaxed);
+        }
+        finish_job(entry.size);
+    });
+}
+
+void AsyncDeleter::submit(const std::string& file, uint64_t size){
+    submit(std::string(file), size);
+}
+
+void AsyncDeleter::submit(std::string&& file, uint64_t size){
+    working_jobs.fetch_add(1);
+    pending.fetch_add(size, std::memory_order_relaxed);
+    asio::post(io, [this, file = std::move(file), size](){
+            remove_file(file, size);
     });
 }
 
+void AsyncDeleter::add_batch(std::span<std::string> files, std::span<const uint64_t> sizes){
+    if(files.empty())return;
+    if(sizes.size() && sizes.size() != files.size())throw std::runtime_error("deleter: sizes mismatch");
+    working_jobs.fetch_add(files.size());
+    uint64_t total = 0;
+    for(auto it : sizes)total += it;
+    pending.fetch_add(total, std::memory_order_relaxed);
+
+    //group by parent directory
+    std::vector<DirBatch> dirs;
+    std::unordered_map<std::string, size_t> dir_index;
+    for(size_t i = 0; i < files.size(); i++){
+        auto& it = files[i];
+        size_t slash = it.rfind('/');
+        std::string dir = slash == std::string::npos ? "." : slash == 0 ? "/" : it.substr(0, slash);
+        auto [pos, inserted] = dir_index.try_emplace(std::move(dir), dirs.size());
+        if(inserted)dirs.push_back({pos->first, {}, {}});
+        dirs[pos->second].names.push_back(slash == std::string::npos ? std::move(it) : it.substr(slash + 1));
+        dirs[pos->second].sizes.push_back(sizes.size() ? sizes[i] : 0);
+    }
+
+    //spread the directories over one job per thread, largest first to the least loaded
+    std::sort(dirs.begin(), dirs.end(), [](const DirBatch& a, const DirBatch& b){
+        return a.names.size() > b.names.size();
+    });
+    size_t jobs = std::min(threads, dirs.size());
+    std::vector<std::vector<DirBatch>> job_dirs(jobs);
+    std::vector<size_t> job_files(jobs, 0);
+    for(auto& it : dirs){
+        size_t least = std::min_element(job_files.begin(), job_files.end()) - job_files.begin();
+        job_files[least] += it.names.size();
+        job_dirs[least].push_back(std::move(it));
+    }
+    for(auto& it : job_dirs){
+        asio::post(io, [this, batch = std::move(it)]() mutable{
+            if(use_uring)remove_batch_uring(batch);
+            else for(auto& dir : batch)remove_dir_batch(dir);
+        });
+    }
+}
+
+/*
+ * Called before every unlink: the cost is taken from both buckets first,
+ * then the thread sleeps until the debt is repaid, so concurrent threads
+ * line up behind each other. Emergency mode wakes them and skips this.
+ */
+void AsyncDeleter::throttle(uint64_t bytes){
+    if(!budget_on || emergency_mode)return;
+    std::unique_lock<std::mutex> lock(budget_lock);
+    auto now = TokenBucket::Clock::now();
+    file_bucket.consume(1, now);
+    byte_bucket.consume(bytes, now);
+    long wait = std::max(file_bucket.debt_ms(now), byte_bucket.debt_ms(now));
+    if(wait > 0){
+        budget_cv.wait_for(lock, std::chrono::milliseconds(wait), [this]{
+            return emergency_mode || !budget_on;
+        });
+    }
+}
+
+void AsyncDeleter::set_budget(double files_per_sec, double bytes_per_sec){
+    std::lock_guard<std::mutex> lock(budget_lock);
+    file_bucket.set(files_per_sec, std::max(files_per_sec, 1.0));   //one second of burst
+    byte_bucket.set(bytes_per_sec, std::max(bytes_per_sec, 1.0));
+    budget_on = files_per_sec > 0 || bytes_per_sec > 0;
+    budget_cv.notify_all();
+}
+
+void AsyncDeleter::set_emergency(bool on){
+    std::lock_guard<std::mutex> lock(budget_lock);
+    if(on && !emergency_mode)std::cerr << "deleter: emergency, budget suspended" << std::endl;
+    emergency_mode = on;
+    budget_cv.notify_all();
+}
+
+uint64_t AsyncDeleter::pending_bytes() const{
+    return pending.load(std::memory_order_relaxed);
+}
+
+std::pair<uint64_t, uint64_t> AsyncDeleter::freed() const{
+    return std::make_pair(freed_files.load(), freed_bytes.load());
+}
+
 std::pair<size_t, size_t> AsyncDeleter::status() const{
     return std::make_pair(running_threads.load(), working_jobs.load());
 }
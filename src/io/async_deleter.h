@@ -1,3 +1,6 @@
+#ifndef ASYNC_DELETER_H
+#define ASYNC_DELETER_H
+
 #include <iostream>
 #include <system_error>
 #include <thread>
@@ -7,11 +10,24 @@
 #include <utility>
 #include <atomic>
 #include <queue>
+#include <algorithm>
+#include <span>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
 #include <filesystem>
 #include <condition_variable>
+#include <functional>
+#include <memory>
 
 #include <asio.hpp>
 #include <glob.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "uring.h"
+#include "token_bucket.h"
 
 using asio::io_context;
 namespace fs = std::filesystem;
@@ -22,13 +38,30 @@ public:
                                  std::error_code ec) noexcept;
     //must be noexcept, so not std::function
     using WorkGuard = asio::executor_work_guard<asio::io_context::executor_type>;
-    AsyncDeleter(size_t thr, FailCallback cb);
+    AsyncDeleter(size_t thr, FailCallback cb, bool uring = false);
+    //uring: statx and unlinkat through io_uring (one ring per thread),
+    //the thread pool path is used if the kernel doesn't support it
     ~AsyncDeleter();
     void run();
     void stop();
     void force_stop();
-    void submit(const std::string& file);
+    void submit(const std::string& file, uint64_t size = 0);
+    void submit(std::string&& file, uint64_t size = 0);
+    void add_batch(std::span<std::string> files, std::span<const uint64_t> sizes = {});
+    //the files are moved from, grouped by directory and unlinked with
+    //unlinkat() relative to one dirfd per directory
+    //size (optional): what the file takes on disk, counted in pending_bytes()
+    //until the file is processed
+
+    //I/O budget, 0 for no limit, applied to every unlink by all threads
+    void set_budget(double files_per_sec, double bytes_per_sec);
+    //emergency (low disk): the budget is ignored until it is turned off
+    void set_emergency(bool on);
+    bool emergency() const{return emergency_mode;}
+    uint64_t pending_bytes() const;                 //queued, not yet freed
     std::pair<size_t, size_t> status() const;
+    std::pair<uint64_t, uint64_t> freed() const;  //files, bytes (allocated blocks)
+    bool uring_enabled() const{return use_uring;}
     
 
 private:
@@ -37,10 +70,30 @@ private:
     std::condition_variable cv;
     std::atomic<size_t> running_threads;
     std::atomic<size_t> working_jobs;
+    std::atomic<uint64_t> freed_files = 0, freed_bytes = 0;
+    std::atomic<uint64_t> pending = 0;
+    std::mutex budget_lock;
+    std::condition_variable budget_cv;
+    TokenBucket file_bucket, byte_bucket;
+    std::atomic<bool> budget_on = false, emergency_mode = false;
     FailCallback fail_callback;
     asio::io_context io;
     WorkGuard* work_guard;
     std::vector<std::thread> thread_pool;
+    const bool use_uring;
+
+    struct DirBatch{
+        std::string dir;
+        std::vector<std::string> names;
+        std::vector<uint64_t> sizes;       //hints, for pending_bytes()
+    };
 
     void wait_thread();
+    void finish_job(uint64_t size = 0);
+    void throttle(uint64_t bytes);
+    void remove_file(const std::string& file, uint64_t size = 0);
+    void remove_dir_batch(DirBatch& batch);
+    void remove_batch_uring(std::vector<DirBatch>& batch);
 };
+
+#endif
@@ -0,0 +1,151 @@
+#include "cache_gc.h"
+
+CacheGC::CacheGC(AsyncDeleter& del, const CachePath& cp) : CacheGC(del, cp, Options()) {}
+
+CacheGC::CacheGC(AsyncDeleter& del, const CachePath& cp, const Options& opt) :
+                 deleter(del), cache_path(cp), options(opt), walker(cp, opt.threads, true), bloom(0){
+    if(options.batch == 0)throw std::runtime_error("gc: batch must not be zero");
+    walker.set_budget(options.scan_rate);
+    delete_budget.set(options.delete_rate, std::max<double>(options.delete_rate, options.batch));
+}
+
+CacheGC::~CacheGC(){
+    stop();
+}
+
+void CacheGC::start(std::vector<Md5Digest>&& digests){
+    if(running)throw std::runtime_error("gc: already running");
+    wait();
+    tracked = std::move(digests);
+    std::sort(tracked.begin(), tracked.end());
+    bloom = BloomFilter(tracked.size());
+    for(auto& it : tracked)bloom.add(it);
+
+    orphan_count = variant_count = young_count = busy_count = garbage_bytes = 0;
+    batches.assign(walker.threads(), {});
+    sizes.assign(walker.threads(), {});
+    open_inodes.clear();
+    proc_scanned = false;
+    stopping = false;
+    running = true;
+    gc_thread = std::thread(&CacheGC::run, this);
+}
+
+void CacheGC::wait(){
+    if(gc_thread.joinable())gc_thread.join();
+}
+
+void CacheGC::stop(){
+    stopping = true;
+    walker.cancel();
+    wait();
+}
+
+CacheGC::Progress CacheGC::progress() const{
+    return {running, walker.dirs_total(), walker.dirs_done(), walker.entries(),
+            orphan_count, variant_count, young_count, busy_count, garbage_bytes};
+}
+
+void CacheGC::run(){
+    auto start = std::chrono::steady_clock::now();
+    try{
+        struct stat st;
+        if(stat(cache_path.root().c_str(), &st) == 0)cache_dev = st.st_dev;
+        if(!stopping){
+            walker.walk([this](size_t thread, const CacheWalker::Entry& entry){
+                visit(thread, entry);
+            });
+        }
+        for(size_t i = 0; i < batches.size(); i++)flush(i);
+    }catch(const std::exception& e){
+        std::cerr << "exception: " << e.what() << std::endl;
+    }
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cerr << "gc: " << walker.entries() << " entries in " << sec << "s, " << orphan_count << " orphans, "
+    << variant_count << " variants (" << garbage_bytes / 1048576 << " MB), skipped " << young_count
+    << " young, " << busy_count << " open" << (stopping ? ", stopped" : "") << std::endl;
+    running = false;
+}
+
+bool CacheGC::is_tracked(const Md5Digest& digest) const{
+    if(!bloom.contains(digest))return false;
+    return std::binary_search(tracked.begin(), tracked.end(), digest);
+}
+
+void CacheGC::scan_proc(){
+    std::error_code ec;
+    for(auto& proc : fs::directory_iterator("/proc", ec)){
+        auto name = proc.path().filename().string();
+        if(name.empty() || name.find_first_not_of("0123456789") != std::string::npos)continue;
+        for(auto& fd : fs::directory_iterator(proc.path() / "fd", ec)){
+            struct stat st;
+            if(stat(fd.path().c_str(), &st) == 0 && st.st_dev == cache_dev && S_ISREG(st.st_mode)){
+                open_inodes.insert(st.st_ino);
+            }
+        }
+    }
+}
+
+/*
+ * The lease is released right away, it only tells whether someone else
+ * has the file open at this moment. A file opened after the check is not
+ * harmed by the unlink (the inode lives until it is closed), the check
+ * is there for nginx still writing a variant or a temp file.
+ */
+bool CacheGC::is_open(const CacheWalker::Entry& entry){
+    int fd = openat(entry.dir_fd, std::string(entry.name).c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if(fd < 0)return errno != ENOENT;
+    int res = fcntl(fd, F_SETLEASE, F_WRLCK);
+    int err = errno;
+    if(res == 0)fcntl(fd, F_SETLEASE, F_UNLCK);
+    close(fd);
+    if(res == 0)return false;
+    if(err == EAGAIN || err == EBUSY)return true;
+    std::lock_guard<std::mutex> lock(proc_lock);
+    if(!proc_scanned){
+        scan_proc();
+        proc_scanned = true;
+    }
+    return open_inodes.count(entry.ino);
+}
+
+void CacheGC::visit(size_t thread, const CacheWalker::Entry& entry){
+    if(stopping)return;
+    Md5Digest digest;
+    bool variant = entry.name.size() > 33 && entry.name[32] == '.';
+    if(!md5_parse(entry.name.substr(0, 32), digest))return;    //not an nginx cache file
+    if(!variant && (entry.name.size() != 32 || is_tracked(digest)))return;
+
+    if(entry.mtime > static_cast<int64_t>(time(nullptr)) - options.min_age){
+        young_count++;
+        return;
+    }
+    if(is_open(entry)){
+        busy_count++;
+        return;
+    }
+    (variant ? variant_count : orphan_count)++;
+    garbage_bytes += entry.blocks * 512;
+    if(options.dry_run)return;
+    batches[thread].push_back(entry.dir + std::string(entry.name));
+    sizes[thread].push_back(entry.blocks * 512);
+    if(batches[thread].size() >= options.batch)flush(thread);
+}
+
+void CacheGC::flush(size_t thread){
+    auto& batch = batches[thread];
+    if(batch.empty())return;
+    long wait;
+    {
+        std::lock_guard<std::mutex> lock(delete_lock);
+        delete_budget.consume(batch.size());
+        wait = delete_budget.debt_ms();
+    }
+    while(wait > 0 && !stopping){
+        std::this_thread::sleep_for(std::chrono::milliseconds(std::min(wait, 100L)));
+        wait -= 100;
+    }
+    if(!stopping)deleter.add_batch(batch, sizes[thread]);
+    batch.clear();
+    sizes[thread].clear();
+}
@@ -0,0 +1,111 @@
+/*
+ * Garbage collector of the cache tree
+ * Removes the files no policy accounts for:
+ *   orphans:  a name that is not the md5 of any tracked key (cached while
+ *             the manager was down, lost by a crash, evicted but missed)
+ *   variants: "<md5>.<suffix>", see the note on renew() in algo_lru.cpp
+ * The tree is walked by a CacheWalker, each name is checked against a
+ * bloom filter of the tracked digests first, and against the sorted
+ * digests only when it may be tracked (most files at steady state).
+ *
+ * A file is left alone if it is younger than min_age (its log line may
+ * not be imported yet) or open by another process: a write lease can
+ * only be taken on a file nobody else has open. Without the right to take
+ * leases (not the owner of the files, no CAP_LEASE), the open files are
+ * read from /proc/<pid>/fd once per pass instead.
+ *
+ * A pass runs in its own thread, the garbage goes to the AsyncDeleter in
+ * batches paced by delete_rate, the walk is paced by scan_rate.
+ */
+
+#ifndef CACHE_GC_H
+#define CACHE_GC_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "async_deleter.h"
+#include "bloom_filter.h"
+#include "cache_path.h"
+#include "cache_walker.h"
+#include "md5.h"
+#include "token_bucket.h"
+
+#define GC_THREADS 2
+#define GC_MIN_AGE 600         //s
+#define GC_BATCH   256
+
+class CacheGC{
+public:
+    struct Options{
+        size_t threads = GC_THREADS;
+        int64_t min_age = GC_MIN_AGE;
+        double scan_rate = 0;              //directory entries/s, 0: no limit
+        double delete_rate = 0;            //files/s, 0: no limit
+        size_t batch = GC_BATCH;
+        bool dry_run = false;              //count, do not delete
+    };
+
+    struct Progress{
+        bool running;
+        size_t dirs_total, dirs_done;      //first level directories
+        uint64_t scanned, orphans, variants;
+        uint64_t young, busy;              //garbage left alone
+        uint64_t bytes;                    //allocated size of the garbage
+    };
+
+    CacheGC(AsyncDeleter& deleter, const CachePath& cache_path);
+    CacheGC(AsyncDeleter& deleter, const CachePath& cache_path, const Options& opt);
+    ~CacheGC();
+
+    //tracked: the cache file names of the policy index (DirectPurger::digests)
+    void start(std::vector<Md5Digest>&& tracked);
+    void wait();
+    void stop();
+    Progress progress() const;
+
+private:
+    AsyncDeleter& deleter;
+    const CachePath cache_path;
+    const Options options;
+    CacheWalker walker;
+    std::thread gc_thread;
+    std::atomic<bool> running = false, stopping = false;
+
+    std::vector<Md5Digest> tracked;        //sorted
+    BloomFilter bloom;
+    std::atomic<uint64_t> orphan_count = 0, variant_count = 0, young_count = 0, busy_count = 0;
+    std::atomic<uint64_t> garbage_bytes = 0;
+
+    std::vector<std::vector<std::string>> batches;  //per walker thread
+    std::vector<std::vector<uint64_t>> sizes;
+    std::mutex delete_lock;
+    TokenBucket delete_budget;
+
+    std::mutex proc_lock;
+    bool proc_scanned = false;
+    std::unordered_set<uint64_t> open_inodes;  //from /proc, when leases are refused
+    dev_t cache_dev = 0;
+
+    void run();
+    void visit(size_t thread, const CacheWalker::Entry& entry);
+    bool is_tracked(const Md5Digest& digest) const;
+    bool is_open(const CacheWalker::Entry& entry);
+    void scan_proc();
+    void flush(size_t thread);
+};
+
+#endif
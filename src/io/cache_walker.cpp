@@ -0,0 +1,135 @@
+#include "cache_walker.h"
+
+CacheWalker::CacheWalker(const CachePath& cp, size_t thr, bool stat) :
+                         cache_path(cp), thread_num(std::max<size_t>(thr, 1)), do_stat(stat) {}
+
+void CacheWalker::set_budget(double entries_per_sec){
+    std::lock_guard<std::mutex> lock(budget_lock);
+    budget.set(entries_per_sec, std::max(entries_per_sec, 1.0));
+}
+
+void CacheWalker::cancel(){
+    cancelled = true;
+}
+
+void CacheWalker::error(const std::string& path, int err){
+    if(error_count++ < 10)std::cerr << "warning: walker: " << path << ": " << strerror(err) << std::endl;
+}
+
+bool CacheWalker::is_level(std::string_view name, size_t depth) const{
+    if(name.size() != static_cast<size_t>(cache_path.levels()[depth]))return false;
+    for(auto c : name){
+        if(!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f')))return false;
+    }
+    return true;
+}
+
+void CacheWalker::throttle(size_t entries){
+    long wait;
+    {
+        std::lock_guard<std::mutex> lock(budget_lock);
+        budget.consume(entries);
+        wait = budget.debt_ms();
+    }
+    //in short steps, to notice cancel()
+    while(wait > 0 && !cancelled){
+        std::this_thread::sleep_for(std::chrono::milliseconds(std::min(wait, 100L)));
+        wait -= 100;
+    }
+}
+
+bool CacheWalker::list(int fd, std::vector<char>& buffer, const std::function<void(const Dirent*)>& each){
+    while(!cancelled){
+        long len = syscall(SYS_getdents64, fd, buffer.data(), buffer.size());
+        if(len < 0)return false;
+        if(len == 0)return true;
+        size_t count = 0;
+        for(long pos = 0; pos < len; count++){
+            auto *ent = reinterpret_cast<const Dirent*>(buffer.data() + pos);
+            pos += ent->reclen;
+            if(ent->name[0] == '.' && (!ent->name[1] || (ent->name[1] == '.' && !ent->name[2])))continue;
+            each(ent);
+        }
+        entry_count.fetch_add(count, std::memory_order_relaxed);
+        throttle(count);
+    }
+    return true;
+}
+
+/*
+ * The subdirectories are collected first and walked after the listing,
+ * so only the leaf level reads into the thread's buffer while visiting.
+ */
+void CacheWalker::walk_dir(int parent_fd, const std::string& name, const std::string& path, size_t depth,
+                           size_t thread, std::vector<char>& buffer, const Visitor& visit){
+    int fd = openat(parent_fd, name.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if(fd < 0){
+        if(errno != ENOENT && errno != ENOTDIR)error(path, errno); //removed meanwhile by the cache manager
+        return;
+    }
+    bool leaf = depth == cache_path.levels().size();
+    std::vector<std::string> subdirs;
+    bool ok = list(fd, buffer, [&](const Dirent* ent){
+        std::string_view file(ent->name);
+        if(!leaf){
+            if((ent->type == DT_DIR || ent->type == DT_UNKNOWN) && is_level(file, depth))subdirs.emplace_back(file);
+            return;
+        }
+        if(ent->type != DT_REG && ent->type != DT_UNKNOWN)return;
+        Entry entry{path, file, fd};
+        entry.ino = ent->ino;
+        if(do_stat || ent->type == DT_UNKNOWN){
+            struct statx stx;
+            if(statx(fd, ent->name, AT_SYMLINK_NOFOLLOW | AT_STATX_DONT_SYNC,
+                     STATX_TYPE | STATX_SIZE | STATX_BLOCKS | STATX_MTIME | STATX_INO, &stx)){
+                if(errno != ENOENT)error(path + ent->name, errno);
+                return;
+            }
+            if(!S_ISREG(stx.stx_mode))return;
+            entry.size = stx.stx_size;
+            entry.blocks = stx.stx_blocks;
+            entry.mtime = stx.stx_mtime.tv_sec;
+            entry.ino = stx.stx_ino;
+        }
+        visit(thread, entry);
+    });
+    if(!ok)error(path, errno);
+    for(auto& it : subdirs){
+        if(cancelled)break;
+        walk_dir(fd, it, path + it + '/', depth + 1, thread, buffer, visit);
+    }
+    close(fd);
+}
+
+void CacheWalker::walk(const Visitor& visit){
+    cancelled = false;
+    next_dir = done_dirs = 0;
+    entry_count = error_count = 0;
+
+    const std::string& root = cache_path.root();
+    int root_fd = open(root.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if(root_fd < 0)throw std::runtime_error("walker: cannot open " + root + ": " + strerror(errno));
+    std::vector<std::string> top;
+    std::vector<char> buffer(WALK_BUFFER);
+    bool ok = list(root_fd, buffer, [&](const Dirent* ent){
+        if((ent->type == DT_DIR || ent->type == DT_UNKNOWN) && is_level(ent->name, 0))top.emplace_back(ent->name);
+    });
+    if(!ok){
+        int err = errno;
+        close(root_fd);
+        throw std::runtime_error("walker: cannot read " + root + ": " + strerror(err));
+    }
+    total_dirs = top.size();
+
+    auto worker = [&](size_t thread){
+        std::vector<char> buf(WALK_BUFFER);
+        for(size_t i; !cancelled && (i = next_dir++) < top.size(); done_dirs++){
+            walk_dir(root_fd, top[i], root + top[i] + '/', 1, thread, buf, visit);
+        }
+    };
+    std::vector<std::thread> pool;
+    for(size_t i = 1; i < std::min(thread_num, top.size()); i++)pool.emplace_back(worker, i);
+    worker(0);
+    for(auto& it : pool)it.join();
+    close(root_fd);
+}
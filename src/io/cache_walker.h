@@ -0,0 +1,94 @@
+/*
+ * Parallel walk of an nginx cache tree (proxy_cache_path ... levels=)
+ * The first level directories are shared between the threads, each one
+ * reads its directories with getdents64() in WALK_BUFFER batches and
+ * resolves the names relative to the directory fd, so the kernel does
+ * one lookup per name instead of one per path component. With stat, each
+ * file is also statx()ed (size, allocated blocks, mtime, inode).
+ *
+ * The visitor is called concurrently, with the index of the calling
+ * thread so it can keep per-thread state without locking. Whatever does
+ * not fit the levels layout (the temp dir, stray files at the upper
+ * levels) is skipped.
+ */
+
+#ifndef CACHE_WALKER_H
+#define CACHE_WALKER_H
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "cache_path.h"
+#include "token_bucket.h"
+
+#define WALK_THREADS 4
+#define WALK_BUFFER  65536     //getdents64 buffer
+
+class CacheWalker{
+public:
+    struct Entry{
+        const std::string& dir;            //with a trailing '/'
+        std::string_view name;
+        int dir_fd;
+        uint64_t size = 0, blocks = 0;     //bytes, 512-byte blocks (with stat)
+        int64_t mtime = 0;
+        uint64_t ino = 0;
+    };
+    using Visitor = std::function<void(size_t thread, const Entry& entry)>;
+
+    CacheWalker(const CachePath& cache_path, size_t threads = WALK_THREADS, bool stat = true);
+
+    void walk(const Visitor& visit);       //returns when the tree is done or cancelled
+    void set_budget(double entries_per_sec);   //0: no limit
+    void cancel();
+    size_t threads() const{return thread_num;}
+
+    size_t dirs_total() const{return total_dirs;}  //first level
+    size_t dirs_done() const{return done_dirs;}
+    uint64_t entries() const{return entry_count;}
+    uint64_t errors() const{return error_count;}
+
+private:
+    const CachePath cache_path;
+    const size_t thread_num;
+    const bool do_stat;
+    std::atomic<bool> cancelled = false;
+    std::atomic<size_t> next_dir = 0, total_dirs = 0, done_dirs = 0;
+    std::atomic<uint64_t> entry_count = 0, error_count = 0;
+    std::mutex budget_lock;
+    TokenBucket budget;
+
+    struct Dirent{
+        uint64_t ino;
+        int64_t off;
+        unsigned short reclen;
+        unsigned char type;
+        char name[];
+    };
+
+    bool list(int fd, std::vector<char>& buffer, const std::function<void(const Dirent*)>& each);
+    void walk_dir(int parent_fd, const std::string& name, const std::string& path, size_t depth,
+                  size_t thread, std::vector<char>& buffer, const Visitor& visit);
+    void throttle(size_t entries);
+    void error(const std::string& path, int err);
+    bool is_level(std::string_view name, size_t depth) const;
+};
+
+#endif
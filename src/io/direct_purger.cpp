@@ -0,0 +1,42 @@
+#include "direct_purger.h"
+
+DirectPurger::DirectPurger(AsyncDeleter& del, const CachePath& cp, const std::string& prefix) :
+                           deleter(del), cache_path(cp), key_prefix(prefix) {}
+
+std::string DirectPurger::key(const std::string& path) const{
+    return cache_key(key_prefix, path);
+}
+
+std::string DirectPurger::file(const std::string& path) const{
+    return cache_path.path(key(path));
+}
+
+void DirectPurger::add(const std::string& path){
+    deleter.submit(file(path));
+}
+
+void DirectPurger::add_batch(std::span<const std::string> paths){
+    std::vector<std::string> keys;
+    std::vector<std::string_view> views;
+    std::vector<std::string> files;
+    keys.reserve(paths.size());
+    views.reserve(paths.size());
+    for(auto& it : paths){
+        keys.push_back(key(it));
+        views.push_back(keys.back());
+    }
+    cache_path.paths(views, files);
+    deleter.add_batch(files);
+}
+
+void DirectPurger::digests(std::span<const std::string> paths, std::vector<Md5Digest>& out) const{
+    std::vector<std::string> keys;
+    std::vector<std::string_view> views;
+    keys.reserve(paths.size());
+    views.reserve(paths.size());
+    for(auto& it : paths){
+        keys.push_back(key(it));
+        views.push_back(keys.back());
+    }
+    md5_batch(views, out);
+}
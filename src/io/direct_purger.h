@@ -0,0 +1,42 @@
+/*
+ * Purge the cache files directly, without ngx_cache_purge
+ * The file of a path is derived from proxy_cache_key (see CachePath) and
+ * removed by the AsyncDeleter, nginx is not involved. key_prefix is the
+ * part of proxy_cache_key before $request_uri, e.g. "https://pypi.org"
+ * for the default $scheme$proxy_host$request_uri.
+ *
+ * nginx still has the key in its shared memory zone until it notices
+ * the missing file (on the next access or by the cache manager), which
+ * is harmless: the next request is a MISS and fetches the file again.
+ */
+
+#ifndef DIRECT_PURGER_H
+#define DIRECT_PURGER_H
+
+#include <span>
+#include <string>
+#include <vector>
+
+#include "async_deleter.h"
+#include "cache_path.h"
+
+class DirectPurger{
+public:
+    DirectPurger(AsyncDeleter& deleter, const CachePath& cache_path,
+                 const std::string& key_prefix = "");
+
+    void add(const std::string& path);              //same path format as Purger::add
+    void add_batch(std::span<const std::string> paths);
+    std::string file(const std::string& path) const;
+    //names of the cache files of these paths (for the GC and reconciliation)
+    void digests(std::span<const std::string> paths, std::vector<Md5Digest>& out) const;
+
+private:
+    AsyncDeleter& deleter;
+    const CachePath cache_path;
+    const std::string key_prefix;
+
+    std::string key(const std::string& path) const;
+};
+
+#endif
@@ -0,0 +1,190 @@
+#include "fs_monitor.h"
+
+#define UPPER_MASK (IN_CREATE | IN_MOVED_TO | IN_ONLYDIR)
+#define LEAF_MASK  (IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE | IN_MOVED_FROM | IN_ONLYDIR)
+
+Monitor::Monitor(const CachePath& cp, CallBack cb, const std::string& prefix,
+                 const std::shared_ptr<Logger>& logger) :
+                 cache_path(cp), callback(cb), key_prefix(prefix), logger(logger){
+    if(!callback)throw MonitorError("monitor: no callback");
+}
+
+Monitor::~Monitor(){
+    stop();
+    if(inotify_fd >= 0)close(inotify_fd);
+    if(stop_fd >= 0)close(stop_fd);
+}
+
+size_t Monitor::watches() const{
+    return dirs.size();
+}
+
+uint64_t Monitor::events() const{
+    return event_count.load();
+}
+
+uint64_t Monitor::delivered() const{
+    return delivered_count.load();
+}
+
+uint64_t Monitor::overflows() const{
+    return overflow_count.load();
+}
+
+void Monitor::warn(const std::string& msg){
+    if(logger)logger->put_warn(LOG_ZONE_MONITOR, msg);
+    else std::cerr << "manager: " << msg << std::endl;
+}
+
+bool Monitor::is_level(std::string_view name, size_t depth) const{
+    if(name.size() != static_cast<size_t>(cache_path.levels()[depth]))return false;
+    return std::all_of(name.begin(), name.end(), [](char c){
+        return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f');
+    });
+}
+
+void Monitor::init(){
+    if(inotify_fd >= 0)throw MonitorError("monitor: already initialized");
+    inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if(inotify_fd < 0)throw MonitorError(std::string("monitor: inotify_init1: ") + std::strerror(errno));
+    stop_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if(stop_fd < 0)throw MonitorError(std::string("monitor: eventfd: ") + std::strerror(errno));
+    if(!fs::is_directory(cache_path.root()))throw MonitorError("monitor: no such directory: " + cache_path.root());
+    watch(cache_path.root(), 0, false);
+}
+
+/*
+ * A directory created by nginx may already hold files when its watch is
+ * added, with scan they are reported as written.
+ */
+void Monitor::watch(const std::string& path, size_t depth, bool scan){
+    size_t leaf = cache_path.levels().size();
+    int wd = inotify_add_watch(inotify_fd, path.c_str(), depth == leaf ? LEAF_MASK : UPPER_MASK);
+    if(wd < 0){
+        if(errno == ENOSPC)warn("monitor: out of inotify watches (fs.inotify.max_user_watches), " + path + " not watched");
+        else if(errno != ENOENT)warn("monitor: fail to watch " + path + ": " + std::strerror(errno));
+        return;
+    }
+    dirs[wd] = {path, depth};
+
+    std::error_code ec;
+    for(auto& it : fs::directory_iterator(path, ec)){
+        std::string name = it.path().filename().string();
+        if(depth < leaf){
+            if(is_level(name, depth) && it.is_directory(ec))watch(path + name + '/', depth + 1, scan);
+        }else if(scan){
+            Md5Digest digest;
+            if(md5_parse(name, digest))pending[name] = {path + name, WRITTEN};
+        }
+    }
+}
+
+void Monitor::run(){
+    if(inotify_fd < 0)throw MonitorError("monitor: not initialized");
+    if(monitor_thread.joinable())throw MonitorError("monitor: already running");
+    monitor_thread = std::thread(&Monitor::monitor_loop, this);
+}
+
+void Monitor::stop(){
+    if(!monitor_thread.joinable())return;
+    uint64_t one = 1;
+    if(write(stop_fd, &one, sizeof(one)) < 0)warn(std::string("monitor: fail to signal stop: ") + std::strerror(errno));
+    monitor_thread.join();
+}
+
+void Monitor::drain_events(){
+    alignas(inotify_event) char buf[65536];
+    size_t leaf = cache_path.levels().size();
+    while(true){
+        ssize_t len = read(inotify_fd, buf, sizeof(buf));
+        if(len <= 0){
+            if(len < 0 && errno != EAGAIN && errno != EINTR)warn(std::string("monitor: read: ") + std::strerror(errno));
+            return;
+        }
+        for(ssize_t pos = 0; pos < len;){
+            auto *ev = reinterpret_cast<inotify_event*>(buf + pos);
+            pos += sizeof(inotify_event) + ev->len;
+            event_count++;
+            if(ev->mask & IN_Q_OVERFLOW){
+                if(overflow_count++ == 0)warn("monitor: inotify queue overflow, some events are lost");
+                continue;
+            }
+            if(ev->mask & IN_IGNORED){         //directory removed
+                dirs.erase(ev->wd);
+                continue;
+            }
+            auto dir = dirs.find(ev->wd);
+            if(dir == dirs.end() || ev->len == 0)continue;
+            std::string name(ev->name);
+            if(dir->second.depth < leaf){
+                if((ev->mask & IN_ISDIR) && is_level(name, dir->second.depth)){
+                    watch(dir->second.path + name + '/', dir->second.depth + 1, true);
+                }
+                continue;
+            }
+            Md5Digest digest;
+            if(!md5_parse(name, digest))continue;   //temp files and variants
+            EventType type = ev->mask & (IN_DELETE | IN_MOVED_FROM) ? DELETED : WRITTEN;
+            pending[name] = {dir->second.path + name, type};
+        }
+    }
+}
+
+void Monitor::flush(){
+    if(pending.empty())return;
+    std::vector<Event> batch;
+    batch.reserve(pending.size());
+    for(auto& [name, it] : pending){
+        Event ev{{}, "", 0, it.type};
+        md5_parse(name, ev.digest);
+        if(it.type == WRITTEN){
+            struct statx stx;
+            if(statx(AT_FDCWD, it.path.c_str(), AT_SYMLINK_NOFOLLOW | AT_STATX_DONT_SYNC,
+                     STATX_BLOCKS, &stx) == 0){
+                ev.size = stx.stx_blocks * 512;
+                ev.key = read_cache_key(it.path, key_prefix);
+            }else{
+                ev.type = DELETED;             //gone before we looked
+            }
+        }
+        batch.push_back(std::move(ev));
+    }
+    pending.clear();
+    delivered_count += batch.size();
+    try{
+        callback(std::move(batch));
+    }catch(const std::exception& e){
+        warn(std::string("monitor: callback: ") + e.what());
+    }
+}
+
+void Monitor::monitor_loop(){
+    auto first = std::chrono::steady_clock::now();
+    while(true){
+        int timeout = -1;
+        if(pending.size()){
+            auto waited = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - first);
+            timeout = std::max<int>(MONITOR_BATCH_INTVL - waited.count(), 0);
+        }
+        pollfd fds[2] = {{inotify_fd, POLLIN, 0}, {stop_fd, POLLIN, 0}};
+        int res = poll(fds, 2, timeout);
+        if(res < 0 && errno != EINTR){
+            warn(std::string("monitor: poll: ") + std::strerror(errno));
+            std::this_thread::sleep_for(std::chrono::milliseconds(MONITOR_BATCH_INTVL));
+            continue;
+        }
+        if(res > 0 && fds[1].revents)break;
+        bool idle = pending.empty();
+        if(res > 0 && fds[0].revents)drain_events();
+        if(idle && pending.size())first = std::chrono::steady_clock::now();
+        if(pending.size() >= MONITOR_BATCH || (pending.size() && std::chrono::steady_clock::now() - first >=
+           std::chrono::milliseconds(MONITOR_BATCH_INTVL))){
+            flush();
+        }
+    }
+
+    drain_events();
+    flush();
+    uint64_t value;
+    while(read(stop_fd, &value, sizeof(value)) > 0); //reset for the next run()
+}
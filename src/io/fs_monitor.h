@@ -1,19 +1,61 @@
+/*
+ * Watch the nginx cache tree for the files written and deleted by nginx
+ * Every directory of the levels tree gets an inotify watch: the upper
+ * levels for the directories nginx creates on demand (they are scanned
+ * once watched, for the files written meanwhile), the last level for
+ * IN_CLOSE_WRITE, IN_MOVED_TO (a temp file renamed in place) and
+ * IN_DELETE/IN_MOVED_FROM. fanotify would need a single mark for the
+ * filesystem but also CAP_SYS_ADMIN, which the manager does not have.
+ *
+ * The events are coalesced by file name for MONITOR_BATCH_INTVL: a file
+ * written several times, or written then deleted, is reported once with
+ * its final state. The written files are statx()ed and their key is read
+ * from the "KEY: " line of the nginx cache header only then, so a burst
+ * of writes does not turn into a burst of stats. key_prefix is removed
+ * from the key, giving the policy key (see read_cache_key()).
+ *
+ * The callback is called from the monitor thread, e.g. to feed
+ * LRU::update()/LFUDA::update() with the bytes really taken on disk.
+ */
+
+#ifndef FS_MONITOR_H
+#define FS_MONITOR_H
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <functional>
 #include <iostream>
-#include <unordered_set>
-#include <unordered_map>
-#include <thread>
-#include <mutex>
-#include <string>
 #include <memory>
 #include <stdexcept>
-#include <cstdint>
-#include <condition_variable>
-#include <functional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
 #include <sys/inotify.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 
+#include "cache_path.h"
+#include "logger.h"
+#include "logging_zones.h"
+#include "md5.h"
+
+namespace fs = std::filesystem;
+
+#define MONITOR_BATCH_INTVL 100      //ms
+#define MONITOR_BATCH       4096     //pending files that force a flush
+
 class MonitorError : public std::runtime_error{
 public:
     explicit MonitorError(const std::string& err) : std::runtime_error(err) {}
@@ -21,13 +63,57 @@ public:
 
 class Monitor{
 public:
-    using CallBack = std::function<void(const std::string, int)>;
-    Monitor(const std::string& dir, CallBack cb);
-    
+    enum EventType{
+        WRITTEN,                           //created, rewritten or renamed in place
+        DELETED
+    };
+    struct Event{
+        Md5Digest digest;                  //the file name
+        std::string key;                   //policy key, empty if DELETED or unreadable
+        uint64_t size;                     //allocated bytes, 0 if DELETED
+        EventType type;
+    };
+    using CallBack = std::function<void(std::vector<Event>&& batch)>;
+
+    Monitor(const CachePath& cache_path, CallBack cb, const std::string& key_prefix = "",
+            const std::shared_ptr<Logger>& logger = nullptr);
+    ~Monitor();
+    void init();                           //watch the existing tree
+    void run();
+    void stop();                           //the pending events are delivered on stop
+
+    size_t watches() const;
+    uint64_t events() const;               //raw inotify events
+    uint64_t delivered() const;            //after coalescing
+    uint64_t overflows() const;            //IN_Q_OVERFLOW, some events were lost
 
 private:
-    unordered_set<std::string> dirs;
+    const CachePath cache_path;
     CallBack callback;
+    const std::string key_prefix;
+    std::shared_ptr<Logger> logger;
 
+    struct Dir{
+        std::string path;                  //with a trailing '/'
+        size_t depth;                      //0: root, levels().size(): files
+    };
+    struct Pending{
+        std::string path;
+        EventType type;
+    };
 
+    int inotify_fd = -1, stop_fd = -1;
+    std::unordered_map<int, Dir> dirs;     //by watch descriptor
+    std::unordered_map<std::string, Pending> pending;   //by file name
+    std::atomic<uint64_t> event_count = 0, delivered_count = 0, overflow_count = 0;
+    std::thread monitor_thread;
+
+    void warn(const std::string& msg);
+    bool is_level(std::string_view name, size_t depth) const;
+    void watch(const std::string& path, size_t depth, bool scan);
+    void drain_events();
+    void flush();
+    void monitor_loop();
 };
+
+#endif
@@ -0,0 +1,324 @@
+#include "log_tailer.h"
+
+LogTailer::LogTailer(const std::string& path, const std::string& checkpoint,
+                     const std::shared_ptr<Logger>& logger, size_t chunk_size,
+                     size_t catchup_size, size_t threads) :
+                     file_path(path), ckpt_path(checkpoint), logger(logger),
+                     chunk_size(chunk_size), catchup_size(catchup_size), threads(threads){
+    if(file_path.empty() || ckpt_path.empty() || chunk_size == 0 || threads == 0){
+        throw TailerError("tailer: invalid args");
+    }
+    size_t slash = file_path.rfind('/');
+    dir_path = slash == std::string::npos ? "." : slash == 0 ? "/" : file_path.substr(0, slash);
+    file_name = slash == std::string::npos ? file_path : file_path.substr(slash + 1);
+    if(file_name.empty())throw TailerError("tailer: invalid file path: " + file_path);
+}
+
+LogTailer::~LogTailer(){
+    stop();
+    close_file();
+    if(inotify_fd >= 0)close(inotify_fd);
+    if(stop_fd >= 0)close(stop_fd);
+}
+
+uint64_t LogTailer::offset() const{
+    return file_offset.load();
+}
+
+uint64_t LogTailer::lines() const{
+    return line_count.load();
+}
+
+uint64_t LogTailer::oversized() const{
+    return oversized_count.load();
+}
+
+void LogTailer::warn(const std::string& msg){
+    if(logger)logger->put_warn(LOG_ZONE_REVEIVER, msg);
+    else std::cerr << "manager: " << msg << std::endl;
+}
+
+void LogTailer::init(const BatchCallBack& cb){
+    if(inotify_fd >= 0)throw TailerError("tailer: already initialized");
+    callback = cb;
+    reader.buffer.resize(chunk_size);
+
+    inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if(inotify_fd < 0)throw TailerError(std::string("tailer: inotify_init1: ") + std::strerror(errno));
+    stop_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if(stop_fd < 0)throw TailerError(std::string("tailer: eventfd: ") + std::strerror(errno));
+
+    wd_dir = inotify_add_watch(inotify_fd, dir_path.c_str(), IN_CREATE | IN_MOVED_TO);
+    if(wd_dir < 0)throw TailerError("tailer: fail to watch " + dir_path + ": " + std::strerror(errno));
+
+    if(!open_file(true))warn("tailer: " + file_path + " does not exist yet, waiting");
+}
+
+void LogTailer::run(){
+    if(inotify_fd < 0)throw TailerError("tailer: not initialized");
+    if(tail_thread.joinable())throw TailerError("tailer: already running");
+    tail_thread = std::thread(&LogTailer::tail_loop, this);
+}
+
+void LogTailer::stop(){
+    if(!tail_thread.joinable())return;
+    uint64_t one = 1;
+    if(write(stop_fd, &one, sizeof(one)) < 0)warn(std::string("tailer: fail to signal stop: ") + std::strerror(errno));
+    tail_thread.join();
+}
+
+bool LogTailer::open_file(bool resume){
+    int new_fd = open(file_path.c_str(), O_RDONLY | O_CLOEXEC);
+    if(new_fd < 0){
+        if(errno != ENOENT)warn("tailer: fail to open " + file_path + ": " + std::strerror(errno));
+        return false;
+    }
+    struct stat st;
+    if(fstat(new_fd, &st)){
+        warn("tailer: fail to stat " + file_path + ": " + std::strerror(errno));
+        close(new_fd);
+        return false;
+    }
+
+    close_file();
+    fd = new_fd;
+    file_ino = st.st_ino;
+    file_dev = st.st_dev;
+    file_offset = 0;
+    reader.pending = 0;
+    reader.discarding = false;
+
+    ino_t ino;
+    dev_t dev;
+    uint64_t offset;
+    if(resume && load_checkpoint(ino, dev, offset)){
+        if(ino == file_ino && dev == file_dev && offset <= static_cast<uint64_t>(st.st_size)){
+            file_offset = offset;
+        }else{
+            warn("tailer: checkpoint is for another file (rotated), start from the beginning");
+        }
+    }
+
+    wd_file = inotify_add_watch(inotify_fd, file_path.c_str(), IN_MODIFY | IN_MOVE_SELF | IN_DELETE_SELF);
+    if(wd_file < 0)warn("tailer: fail to watch " + file_path + ": " + std::strerror(errno));
+    //without the watch we still poll every TAIL_POLL
+    return true;
+}
+
+void LogTailer::close_file(){
+    if(fd < 0)return;
+    if(wd_file >= 0)inotify_rm_watch(inotify_fd, wd_file); //fails if the file is gone, that's fine
+    wd_file = -1;
+    close(fd);
+    fd = -1;
+}
+
+size_t LogTailer::split_lines(char* data, size_t len, bool& discarding,
+                              std::vector<std::string_view>& views){
+    size_t pos = 0;
+    if(discarding){
+        auto *newline = static_cast<char*>(std::memchr(data, '\n', len));
+        if(newline == nullptr)return len;
+        discarding = false;
+        pos = newline + 1 - data;
+    }
+    while(pos < len){
+        auto *newline = static_cast<char*>(std::memchr(data + pos, '\n', len - pos));
+        if(newline == nullptr)break;
+        size_t line = newline - (data + pos);
+        if(line && data[pos + line - 1] == '\r')line--;
+        if(line)views.emplace_back(data + pos, line);
+        pos = newline + 1 - data;
+    }
+    return pos;
+}
+
+/*
+ * Read [offset, limit) (or to EOF) chunk by chunk, deliver the complete
+ * lines of each chunk in one batch and advance offset past them.
+ * The incomplete last line stays in r.pending for the next call.
+ */
+void LogTailer::read_chunks(std::atomic<uint64_t>& offset, uint64_t limit, Reader& r){
+    while(true){
+        uint64_t read_pos = offset + r.pending;
+        if(read_pos >= limit)return;
+        size_t want = std::min<uint64_t>(r.buffer.size() - r.pending, limit - read_pos);
+        ssize_t res = pread(fd, r.buffer.data() + r.pending, want, read_pos);
+        if(res < 0){
+            if(errno == EINTR)continue;
+            warn("tailer: fail to read " + file_path + ": " + std::strerror(errno));
+            return;
+        }
+        if(res == 0)return;
+
+        size_t len = r.pending + res;
+        r.views.clear();
+        size_t consumed = split_lines(r.buffer.data(), len, r.discarding, r.views);
+        if(r.views.size()){
+            try{
+                callback(std::span<std::string_view>(r.views.data(), r.views.size()));
+            }catch(const std::exception& e){
+                warn(std::string("tailer: callback failed, batch skipped: ") + e.what());
+            }
+            line_count += r.views.size();
+        }
+
+        if(consumed == 0 && len == r.buffer.size()){
+            oversized_count++;
+            r.discarding = true;
+            consumed = len;
+        }//a line longer than the whole buffer, drop it
+
+        offset += consumed;
+        r.pending = len - consumed;
+        if(r.pending && consumed)std::memmove(r.buffer.data(), r.buffer.data() + consumed, r.pending);
+    }
+}
+
+uint64_t LogTailer::next_line(uint64_t pos, uint64_t limit){
+    char block[65536];
+    while(pos < limit){
+        ssize_t res = pread(fd, block, std::min<uint64_t>(sizeof(block), limit - pos), pos);
+        if(res < 0 && errno == EINTR)continue;
+        if(res <= 0)return limit;
+        auto *newline = static_cast<char*>(std::memchr(block, '\n', res));
+        if(newline)return pos + (newline - block) + 1;
+        pos += res;
+    }
+    return limit;
+}
+
+void LogTailer::catch_up(){
+    struct stat st;
+    if(fd < 0 || fstat(fd, &st))return;
+    uint64_t start = file_offset, end = st.st_size;
+    if(end <= start || end - start < catchup_size || threads < 2)return;
+
+    auto begin = std::chrono::steady_clock::now();
+    std::vector<uint64_t> bounds = {start};
+    for(size_t i = 1; i < threads; i++){
+        uint64_t cut = next_line(start + (end - start) / threads * i, end);
+        if(cut > bounds.back() && cut < end)bounds.push_back(cut);
+    }
+    bounds.push_back(end);
+
+    size_t parts = bounds.size() - 1;
+    std::vector<std::atomic<uint64_t>> offsets(parts);
+    std::vector<Reader> readers(parts);
+    std::vector<std::thread> pool;
+    for(size_t i = 0; i < parts; i++){
+        offsets[i] = bounds[i];
+        readers[i].buffer.resize(chunk_size);
+        pool.emplace_back([this, i, &bounds, &offsets, &readers]{
+            read_chunks(offsets[i], bounds[i + 1], readers[i]);
+        });
+    }
+    for(auto& it : pool)it.join();
+
+    //every part but the last ends at a line boundary
+    for(size_t i = 0; i + 1 < parts; i++){
+        if(offsets[i] != bounds[i + 1]){
+            warn("tailer: catch-up part stopped early at " + std::to_string(offsets[i]));
+        }
+    }
+    file_offset = offsets[parts - 1].load();
+    reader.pending = 0;
+    reader.discarding = readers[parts - 1].discarding;
+    save_checkpoint();
+
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    if(logger){
+        logger->put_info(LOG_ZONE_REVEIVER, "tailer: caught up ", (file_offset - start) / 1048576,
+                         "MB with ", parts, " threads in ", sec, "s, ",
+                         sec > 0 ? (file_offset - start) / sec / 1048576 : 0, " MB/s");
+    }
+}
+
+void LogTailer::drain_events(){
+    alignas(inotify_event) char events[4096];
+    while(read(inotify_fd, events, sizeof(events)) > 0);
+    //what happened is checked in check_file(), the events only wake us up
+}
+
+void LogTailer::check_file(){
+    struct stat cur;
+    if(stat(file_path.c_str(), &cur))return; //moved away and not created yet
+
+    if(fd >= 0 && cur.st_ino == file_ino && cur.st_dev == file_dev){
+        if(static_cast<uint64_t>(cur.st_size) < file_offset + reader.pending){
+            warn("tailer: " + file_path + " truncated, start from the beginning");
+            file_offset = 0;
+            reader.pending = 0;
+            reader.discarding = false;
+        }//copytruncate
+        return;
+    }
+
+    if(fd >= 0){
+        struct stat old;
+        if(!fstat(fd, &old) && old.st_nlink > 0 && cur.st_size == 0)return;
+        //nginx keeps writing the rotated file until it reopens the logs (USR1)
+        read_chunks(file_offset, UINT64_MAX, reader);
+        if(reader.pending)warn("tailer: incomplete last line of the rotated file dropped");
+    }
+    if(open_file(false))save_checkpoint();
+}
+
+bool LogTailer::load_checkpoint(ino_t& ino, dev_t& dev, uint64_t& offset){
+    std::ifstream in(ckpt_path);
+    if(!in)return false;
+    in >> ino >> dev >> offset;
+    if(in.fail()){
+        warn("tailer: broken checkpoint: " + ckpt_path);
+        return false;
+    }
+    return true;
+}
+
+void LogTailer::save_checkpoint(){
+    last_ckpt = std::chrono::steady_clock::now();
+    if(fd < 0)return;
+
+    std::string data = std::to_string(file_ino) + " " + std::to_string(file_dev) + " " +
+                       std::to_string(file_offset.load()) + "\n";
+    std::string tmp = ckpt_path + ".tmp";
+    int out = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if(out < 0){
+        warn("tailer: fail to write checkpoint: " + std::string(std::strerror(errno)));
+        return;
+    }
+    bool ok = write(out, data.data(), data.size()) == static_cast<ssize_t>(data.size()) && !fsync(out);
+    close(out);
+    if(!ok || rename(tmp.c_str(), ckpt_path.c_str())){
+        warn("tailer: fail to write checkpoint: " + std::string(std::strerror(errno)));
+    }//rename is atomic, a crash leaves the old or the new checkpoint
+}
+
+void LogTailer::tail_loop(){
+    catch_up();
+    uint64_t saved = file_offset;
+    while(true){
+        if(fd >= 0)read_chunks(file_offset, UINT64_MAX, reader);
+        check_file();
+        if(file_offset != saved && std::chrono::steady_clock::now() - last_ckpt >=
+           std::chrono::milliseconds(TAIL_CKPT_INTVL)){
+            save_checkpoint();
+            saved = file_offset;
+        }
+
+        pollfd fds[2] = {{inotify_fd, POLLIN, 0}, {stop_fd, POLLIN, 0}};
+        int res = poll(fds, 2, TAIL_POLL);
+        if(res < 0 && errno != EINTR){
+            warn(std::string("tailer: poll: ") + std::strerror(errno));
+            std::this_thread::sleep_for(std::chrono::milliseconds(TAIL_POLL));
+            continue;
+        }
+        if(res > 0 && fds[1].revents)break;
+        if(res > 0 && fds[0].revents)drain_events();
+    }
+
+    if(fd >= 0)read_chunks(file_offset, UINT64_MAX, reader);
+    save_checkpoint();
+    uint64_t value;
+    while(read(stop_fd, &value, sizeof(value)) > 0); //reset for the next run()
+}
@@ -0,0 +1,126 @@
+/*
+ * Tail an nginx access log file (the "file log" input)
+ * Follow the file with inotify and read the new data in large pread()
+ * chunks, the lines are split in place with memchr (vectorized by libc)
+ * and handed to the callback as views, just like Receiver::init_batch.
+ *
+ * Rotation: logrotate (rename + create) is detected by IN_MOVE_SELF on
+ * the file and IN_CREATE/IN_MOVED_TO on its directory, the old file is
+ * read to the end before switching to the new one. copytruncate is
+ * detected by the file becoming shorter than our offset.
+ *
+ * The offset is saved with the inode and device of the file (written to
+ * a temp file and renamed), so a restart resumes where it stopped, and a
+ * checkpoint of another file (rotated meanwhile) is not applied to the
+ * new one. The offset is only advanced after the callback returns, lines
+ * may be delivered twice after a crash but never lost.
+ *
+ * Catch-up: if the backlog at startup is larger than catchup_size, it is
+ * cut at line boundaries and read by several threads at once. In this
+ * mode the callback is called concurrently and the batches are not in
+ * order, so it must be thread-safe.
+ */
+
+#ifndef LOG_TAILER_H
+#define LOG_TAILER_H
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "logger.h"
+#include "logging_zones.h"
+
+#define TAIL_CHUNK      1048576    //1M per pread
+#define TAIL_CATCHUP    67108864   //64M backlog switches to parallel catch-up
+#define TAIL_THREADS    4
+#define TAIL_POLL       1000       //ms, also rechecks the file when an event is missed
+#define TAIL_CKPT_INTVL 1000       //ms between two checkpoints
+
+class TailerError : public std::runtime_error{
+public:
+    explicit TailerError(const std::string& err) : std::runtime_error(err) {}
+};
+
+class LogTailer{
+public:
+    using BatchCallBack = std::function<void(std::span<std::string_view> batch)>;
+    //the views point into the read buffer, only valid inside the callback
+
+    LogTailer(const std::string& path, const std::string& checkpoint,
+              const std::shared_ptr<Logger>& logger = nullptr,
+              size_t chunk_size = TAIL_CHUNK, size_t catchup_size = TAIL_CATCHUP,
+              size_t threads = TAIL_THREADS);
+    ~LogTailer();
+    void init(const BatchCallBack& cb);    //load the checkpoint and open the file
+    void run();
+    void stop();                           //the checkpoint is saved on stop
+
+    uint64_t offset() const;
+    uint64_t lines() const;
+    uint64_t oversized() const;            //lines longer than chunk_size, dropped
+
+
+private:
+    const std::string file_path, ckpt_path;
+    std::string dir_path, file_name;
+    std::shared_ptr<Logger> logger;
+    const size_t chunk_size, catchup_size, threads;
+    BatchCallBack callback;
+
+    struct Reader{
+        std::vector<char> buffer;
+        size_t pending = 0;                //bytes of an incomplete line in buffer
+        bool discarding = false;           //drop until the next '\n' (oversized line)
+        std::vector<std::string_view> views;
+    };
+
+    int fd = -1;
+    ino_t file_ino = 0;
+    dev_t file_dev = 0;
+    std::atomic<uint64_t> file_offset = 0; //consumed bytes (end of the last full line)
+    std::atomic<uint64_t> line_count = 0, oversized_count = 0;
+    Reader reader;
+
+    int inotify_fd = -1, wd_file = -1, wd_dir = -1;
+    int stop_fd = -1;
+    std::thread tail_thread;
+    std::chrono::steady_clock::time_point last_ckpt;
+
+    static size_t split_lines(char* data, size_t len, bool& discarding,
+                              std::vector<std::string_view>& views);
+    void warn(const std::string& msg);
+    bool open_file(bool resume);
+    void close_file();
+    void read_chunks(std::atomic<uint64_t>& offset, uint64_t limit, Reader& r);
+    void catch_up();
+    uint64_t next_line(uint64_t pos, uint64_t limit);
+    void drain_events();
+    void check_file();
+    bool load_checkpoint(ino_t& ino, dev_t& dev, uint64_t& offset);
+    void save_checkpoint();
+    void tail_loop();
+};
+
+#endif
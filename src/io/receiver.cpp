@@ -1,6 +1,11 @@
 #include "receiver.h"
 
 void Receiver::chown_chmod(){
+    chown_chmod(socket_path, socket_owner, socket_group, socket_perms);
+}
+
+void Receiver::chown_chmod(const std::string& socket_path, const std::string& socket_owner,
+                           const std::string& socket_group, int socket_perms){
     struct stat file_stat;
     if(stat(socket_path.c_str(), &file_stat))throw std::runtime_error("manager: fail to get socket owner/perms");
 
@@ -25,8 +30,10 @@ void Receiver::chown_chmod(){
 
 }
 
-Receiver::Receiver(const std::string& socket, const std::string& owner, const std::string& group, const int& perms)
-: socket_path(socket), socket_owner(owner), socket_group(group), socket_perms(perms){
+Receiver::Receiver(const std::string& socket, const std::string& owner, const std::string& group, const int& perms,
+                   const std::shared_ptr<Logger>& logger, size_t rcvbuf_max)
+: socket_path(socket), socket_owner(owner), socket_group(group), socket_perms(perms),
+  logger(logger), rcvbuf_max(rcvbuf_max){
     is_running.store(false), thread_running.store(false);
     if(socket_path.empty() || socket_owner.empty() || socket_group.empty() || socket_perms < 0 || socket_perms > 511)throw std::runtime_error("manager: invalid args");
 }
@@ -51,6 +58,143 @@ bool Receiver::now_running() const{
 
 void Receiver::init(const CallBack& cb){
     callback = cb;
+    recv_mode = RECV_SINGLE;
+    open_socket();
+}
+
+void Receiver::init_batch(const BatchCallBack& cb, size_t slots){
+    if(slots == 0)throw std::runtime_error("manager: invalid batch slots");
+    batch_callback = cb;
+    recv_mode = RECV_BATCH;
+
+    ring.resize(slots * BUFFER_SIZE + RING_PADDING);
+    ring_views.resize(slots);
+    setup_ring(slots);
+    for(size_t i = 0; i < slots; i++){
+        ring_iovs[i] = {ring.data() + i * BUFFER_SIZE, BUFFER_SIZE};
+    }
+
+    open_socket();
+}
+
+void Receiver::init_lease(const std::shared_ptr<BufferPool>& pool, const LeaseCallBack& cb,
+                          size_t slots){
+    if(slots == 0 || pool == nullptr)throw std::runtime_error("manager: invalid args");
+    lease_pool = pool;
+    lease_callback = cb;
+    recv_mode = RECV_LEASE;
+
+    ring.resize(BUFFER_SIZE); //discard buffer when the pool is exhausted
+    ring_leases.resize(slots);
+    setup_ring(slots);
+
+    open_socket();
+}
+
+void Receiver::setup_ring(size_t slots){
+    ring_iovs.resize(slots);
+    ring_msgs.resize(slots);
+    ring_ctrl.assign(slots * CMSG_SPACE(sizeof(uint32_t)), 0);
+    for(size_t i = 0; i < slots; i++){
+        ring_msgs[i] = {};
+        ring_msgs[i].msg_hdr.msg_iov = &ring_iovs[i];
+        ring_msgs[i].msg_hdr.msg_iovlen = 1;
+        ring_msgs[i].msg_hdr.msg_control = ring_ctrl.data() + i * CMSG_SPACE(sizeof(uint32_t));
+        ring_msgs[i].msg_hdr.msg_controllen = CMSG_SPACE(sizeof(uint32_t));
+    }//the sender address is not needed, leave msg_name empty
+}
+
+uint64_t Receiver::lost_datagrams() const{
+    return lost.load();
+}
+
+size_t Receiver::rcvbuf_size() const{
+    return rcvbuf_cur.load();
+}
+
+void Receiver::enable_loss_detect(){
+    int fd = socket->native_handle();
+    int one = 1;
+    if(setsockopt(fd, SOL_SOCKET, SO_RXQ_OVFL, &one, sizeof(one))){
+        if(logger)logger->put_warn(LOG_ZONE_REVEIVER, "fail to enable SO_RXQ_OVFL: ", std::strerror(errno));
+    }
+
+    int size = 0;
+    socklen_t len = sizeof(size);
+    if(!getsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, &len))rcvbuf_cur = size;
+    last_warn = std::chrono::steady_clock::now() - std::chrono::seconds(LOSS_WARN_INTVL);
+}
+
+/*
+ * With SO_RXQ_OVFL the kernel attaches the number of datagrams it dropped
+ * on this socket (since creation) to every datagram we read.
+ * Note: AF_UNIX does not report it (the sender sees EAGAIN instead), so
+ * we also grow SO_RCVBUF when the socket keeps filling the whole ring.
+ */
+void Receiver::check_drops(int recv_msgs, size_t slots){
+    uint64_t new_lost = 0;
+    for(int i = 0; i < recv_msgs; i++){
+        auto& hdr = ring_msgs[i].msg_hdr;
+        for(cmsghdr* cmsg = CMSG_FIRSTHDR(&hdr); cmsg != nullptr; cmsg = CMSG_NXTHDR(&hdr, cmsg)){
+            if(cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SO_RXQ_OVFL)continue;
+            uint32_t counter;
+            std::memcpy(&counter, CMSG_DATA(cmsg), sizeof(counter));
+            new_lost += static_cast<uint32_t>(counter - drop_counter); //wraps around
+            drop_counter = counter;
+        }
+        hdr.msg_controllen = CMSG_SPACE(sizeof(uint32_t)); //reset for the next round
+    }
+
+    if(static_cast<size_t>(recv_msgs) == slots){
+        if(++saturated_rounds == SATURATED_ROUNDS)grow_rcvbuf("socket backlog");
+    }else saturated_rounds = 0;
+
+    if(new_lost == 0)return;
+    lost += new_lost;
+    lost_since_warn += new_lost;
+    grow_rcvbuf("datagram loss");
+
+    auto now = std::chrono::steady_clock::now();
+    if(now - last_warn < std::chrono::seconds(LOSS_WARN_INTVL))return;
+    last_warn = now;
+    if(logger){
+        logger->put_warn(LOG_ZONE_REVEIVER, "kernel dropped ", lost_since_warn,
+                         " datagrams (total ", lost.load(), "), SO_RCVBUF: ", rcvbuf_cur.load());
+    }else{
+        std::cerr << "manager: kernel dropped " << lost_since_warn << " datagrams" << std::endl;
+    }
+    lost_since_warn = 0;
+}
+
+void Receiver::grow_rcvbuf(const char* reason){
+    size_t cur = rcvbuf_cur.load();
+    if(cur >= rcvbuf_max)return;
+    
+    int fd = socket->native_handle();
+    int size = static_cast<int>(std::min(cur * 2, rcvbuf_max) / 2); //the kernel doubles it
+    if(setsockopt(fd, SOL_SOCKET, SO_RCVBUFFORCE, &size, sizeof(size)) &&
+       setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size))){
+        if(logger)logger->put_warn(LOG_ZONE_REVEIVER, "fail to grow SO_RCVBUF: ", std::strerror(errno));
+        return;
+    }//SO_RCVBUFFORCE ignores net.core.rmem_max but needs CAP_NET_ADMIN
+
+    int real = 0;
+    socklen_t len = sizeof(real);
+    getsockopt(fd, SOL_SOCKET, SO_RCVBUF, &real, &len);
+    if(static_cast<size_t>(real) <= cur){
+        rcvbuf_cur = rcvbuf_max; //capped by rmem_max, stop trying
+        if(logger)logger->put_warn(LOG_ZONE_REVEIVER, "SO_RCVBUF capped at ", real, " (check net.core.rmem_max)");
+        return;
+    }
+    rcvbuf_cur = real;
+    if(logger)logger->put_info(LOG_ZONE_REVEIVER, "SO_RCVBUF grown to ", real, " (", reason, ")");
+}
+
+size_t Receiver::pool_exhausted() const{
+    return exhausted.load();
+}
+
+void Receiver::open_socket(){
     if(unlink(socket_path.c_str()) && errno != ENOENT)throw std::runtime_error("manager: fail to unlink socket");//TODO
 //  if(unlink(socket_path.c_str()))throw std::runtime_error("manager: fail to unlink socket");//TODO
     
@@ -68,11 +212,13 @@ void Receiver::init(const CallBack& cb){
     if(err)throw std::runtime_error("manager: fail to bind socket: " + err.message());
     
     chown_chmod();
+    enable_loss_detect();
 }
 
 void Receiver::receive_start(){
     if(is_running.load())throw std::runtime_error("manager: fail to start receiving (already start)");
-    receive();
+    if(recv_mode == RECV_SINGLE)receive();
+    else receive_batch();
     is_running.store(true);
 }
 
@@ -107,3 +253,97 @@ void Receiver::receive(){
     );
 }
 
+void Receiver::receive_batch(){
+    socket->async_wait(
+        datagram_protocol::socket::wait_read,
+        [this](const asio::error_code& err){
+            if(err == asio::error::operation_aborted){
+                std::cerr << "manager: async io operation aborted (receiving stop)" << std::endl;
+                return;
+            }
+            else if(!err){
+                if(recv_mode == RECV_LEASE)drain_lease();
+                else drain();
+            }
+            else std::cerr << "manager: fail to wait for data: " << err.message() << std::endl;
+            receive_batch();
+        }
+    );
+}
+
+void Receiver::drain(){
+    const size_t slots = ring_msgs.size();
+    while(true){
+        int recv_msgs = recvmmsg(socket->native_handle(), ring_msgs.data(),
+                                 slots, MSG_DONTWAIT, nullptr);
+        if(recv_msgs < 0){
+            if(errno == EINTR)continue;
+            if(errno != EAGAIN && errno != EWOULDBLOCK){
+                std::cerr << "manager: fail to receive data: " << std::strerror(errno) << std::endl;
+            }
+            return;
+        }
+
+        for(int i = 0; i < recv_msgs; i++){
+            auto& hdr = ring_msgs[i].msg_hdr;
+            if(hdr.msg_flags & MSG_TRUNC){
+                std::cerr << "manager: datagram truncated to " << BUFFER_SIZE << " bytes" << std::endl;
+            }
+            ring_views[i] = std::string_view(ring.data() + i * BUFFER_SIZE, ring_msgs[i].msg_len);
+            hdr.msg_flags = 0;
+        }
+        check_drops(recv_msgs, slots);
+        if(recv_msgs)batch_callback(std::span<std::string_view>(ring_views.data(), recv_msgs));
+        
+        if(static_cast<size_t>(recv_msgs) < slots)return; //socket drained
+    }
+}
+
+void Receiver::drain_lease(){
+    const size_t slots = ring_msgs.size();
+    while(true){
+        size_t leased = 0;
+        while(leased < slots){
+            if(!ring_leases[leased]){
+                ring_leases[leased] = lease_pool->acquire();
+                if(!ring_leases[leased])break;
+            }//the unused leases are kept for the next round
+            ring_iovs[leased] = {ring_leases[leased].data(), ring_leases[leased].capacity()};
+            leased++;
+        }
+
+        if(leased == 0){
+            //pool exhausted (the pipeline is behind), drop one datagram
+            //instead of spinning on a readable socket
+            ssize_t res = recv(socket->native_handle(), ring.data(), ring.size(), MSG_DONTWAIT);
+            if(res < 0)return;
+            if(exhausted.fetch_add(1) % 1000 == 0){
+                std::cerr << "manager: buffer pool exhausted, datagram dropped" << std::endl;
+            }
+            continue;
+        }
+
+        int recv_msgs = recvmmsg(socket->native_handle(), ring_msgs.data(),
+                                 leased, MSG_DONTWAIT, nullptr);
+        if(recv_msgs < 0){
+            if(errno == EINTR)continue;
+            if(errno != EAGAIN && errno != EWOULDBLOCK){
+                std::cerr << "manager: fail to receive data: " << std::strerror(errno) << std::endl;
+            }
+            return;
+        }
+        check_drops(recv_msgs, leased);
+
+        for(int i = 0; i < recv_msgs; i++){
+            auto& hdr = ring_msgs[i].msg_hdr;
+            if(hdr.msg_flags & MSG_TRUNC){
+                std::cerr << "manager: datagram truncated to " << ring_iovs[i].iov_len << " bytes" << std::endl;
+            }
+            hdr.msg_flags = 0;
+            ring_leases[i].set_size(ring_msgs[i].msg_len);
+            lease_callback(std::move(ring_leases[i]));
+        }
+
+        if(static_cast<size_t>(recv_msgs) < leased)return; //socket drained
+    }
+}
@@ -1,4 +1,9 @@
+#ifndef RECEIVER_H
+#define RECEIVER_H
+
+#include <algorithm>
 #include <cerrno>
+#include <cstring>
 #include <functional>
 #include <iostream>
 #include <stdexcept>
@@ -6,17 +11,31 @@
 #include <chrono>
 #include <thread>
 #include <atomic>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <vector>
 
 #include <pwd.h>
 #include <grp.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/socket.h>
 
 #include <asio.hpp>
 #include <asio/error_code.hpp>
 #include <asio/local/datagram_protocol.hpp>
 
+#include "buffer_pool.h"
+#include "logger.h"
+#include "logging_zones.h"
+
 #define BUFFER_SIZE 4096
+#define BATCH_SLOTS 64
+#define RING_PADDING 64 //readable bytes after the last slot (SIMDJSON_PADDING)
+#define RCVBUF_MAX  16777216 //16M, cap of SO_RCVBUF autotuning
+#define LOSS_WARN_INTVL 10   //s, at most one loss warning per interval
+#define SATURATED_ROUNDS 4   //full recvmmsg rounds in a row before growing SO_RCVBUF
 
 using asio::local::datagram_protocol;
 using asio::io_context;
@@ -24,13 +43,31 @@ using asio::io_context;
 class Receiver{
 public:
      using CallBack = std::function<void(const std::string& data, const datagram_protocol::endpoint& ep)>;
-     Receiver(const std::string& socket, const std::string& owner, const std::string& group, const int& perms);
+     using BatchCallBack = std::function<void(std::span<std::string_view> batch)>;
+     //the views point into the receive ring, only valid inside the callback,
+     //at least RING_PADDING readable bytes follow every view (SimdParser::parse_padded)
+     using LeaseCallBack = std::function<void(BufferPool::Lease&& lease)>;
+     //the datagram is received straight into the leased buffer, no copy
+     Receiver(const std::string& socket, const std::string& owner, const std::string& group, const int& perms,
+              const std::shared_ptr<Logger>& logger = nullptr, size_t rcvbuf_max = RCVBUF_MAX);
      ~Receiver();
      void init(const CallBack& cb);
+     void init_batch(const BatchCallBack& cb, size_t slots = BATCH_SLOTS);
+     //batch mode: wait for readability, then drain the socket with recvmmsg
+     void init_lease(const std::shared_ptr<BufferPool>& pool, const LeaseCallBack& cb,
+                     size_t slots = BATCH_SLOTS);
+     //lease mode: same as batch mode, but the slots are leased from the pool
+     size_t pool_exhausted() const;
+     uint64_t lost_datagrams() const;
+     //cumulative count reported by the kernel (SO_RXQ_OVFL), batch/lease mode only
+     size_t rcvbuf_size() const;
      void io_run();
      void receive_start();
      void receive_stop();
      bool now_running() const;
+     static void chown_chmod(const std::string& socket_path, const std::string& socket_owner,
+                             const std::string& socket_group, int socket_perms);
+     //shared with StreamReceiver
 
 
 private:
@@ -38,10 +75,37 @@ private:
      const std::string socket_owner;
      const std::string socket_group;
      const int socket_perms;
+     std::shared_ptr<Logger> logger;
      
      std::array<char, BUFFER_SIZE> buffer;
      datagram_protocol::endpoint endpoint;
      CallBack callback;
+
+     enum {
+          RECV_SINGLE,
+          RECV_BATCH,
+          RECV_LEASE
+     };
+     int recv_mode = RECV_SINGLE;
+     BatchCallBack batch_callback;
+     LeaseCallBack lease_callback;
+     std::shared_ptr<BufferPool> lease_pool;
+     std::vector<BufferPool::Lease> ring_leases;
+     std::atomic<size_t> exhausted = 0; //datagrams dropped for empty pool
+     std::vector<char> ring;                 //slots * BUFFER_SIZE, preallocated
+     std::vector<iovec> ring_iovs;
+     std::vector<mmsghdr> ring_msgs;
+     std::vector<std::string_view> ring_views;
+     std::vector<char> ring_ctrl;            //ancillary data (drop counter) per slot
+
+     //loss detection & SO_RCVBUF autotuning
+     const size_t rcvbuf_max;
+     std::atomic<size_t> rcvbuf_cur = 0;
+     std::atomic<uint64_t> lost = 0;
+     uint32_t drop_counter = 0;              //last counter seen from the kernel
+     uint64_t lost_since_warn = 0;
+     int saturated_rounds = 0;
+     std::chrono::steady_clock::time_point last_warn;
      
      using WorkGuard = asio::executor_work_guard<io_context::executor_type>;
      io_context* io = nullptr;
@@ -52,5 +116,15 @@ private:
      std::atomic<bool> thread_running, is_running;//TODO: add is_init
 
      void chown_chmod();
+     void open_socket();
      void receive();
+     void receive_batch();
+     void drain();
+     void drain_lease();
+     void setup_ring(size_t slots);
+     void enable_loss_detect();
+     void check_drops(int recv_msgs, size_t slots);
+     void grow_rcvbuf(const char* reason);
 };
+
+#endif
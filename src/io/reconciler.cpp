@@ -0,0 +1,103 @@
+#include "reconciler.h"
+
+Reconciler::Reconciler(const CachePath& cp, const std::string& prefix, size_t thr) :
+                       cache_path(cp), key_prefix(prefix), threads(std::max<size_t>(thr, 1)) {}
+
+std::vector<Reconciler::File> Reconciler::walk(){
+    CacheWalker walker(cache_path, threads, true);
+    std::vector<std::vector<File>> found(walker.threads());
+    walker.walk([&](size_t thread, const CacheWalker::Entry& entry){
+        File file;
+        if(!md5_parse(entry.name, file.digest))return;     //temp files, variants
+        file.size = entry.blocks * 512;
+        file.mtime = entry.mtime;
+        found[thread].push_back(file);
+    });
+    if(walker.errors())std::cerr << "warning: reconciler: " << walker.errors() << " errors while walking" << std::endl;
+
+    size_t total = 0;
+    for(auto& it : found)total += it.size();
+    std::vector<File> files;
+    files.reserve(total);
+    for(auto& it : found){
+        files.insert(files.end(), it.begin(), it.end());
+        std::vector<File>().swap(it);
+    }
+    std::sort(files.begin(), files.end(), [](const File& a, const File& b){
+        return a.digest < b.digest;
+    });
+    return files;
+}
+
+//one open + pread per file, in parallel as there are many on a first run
+void Reconciler::read_keys(const std::vector<const File*>& files, Diff& diff){
+    std::vector<std::string> keys(files.size());
+    std::vector<std::thread> pool;
+    size_t step = (files.size() + threads - 1) / threads;
+    for(size_t begin = 0; begin < files.size(); begin += step){
+        pool.emplace_back([&, begin](){
+            for(size_t i = begin; i < std::min(begin + step, files.size()); i++){
+                keys[i] = read_cache_key(cache_path.path(files[i]->digest), key_prefix);
+            }
+        });
+    }
+    for(auto& it : pool)it.join();
+
+    for(size_t i = 0; i < files.size(); i++){
+        if(keys[i].empty()){
+            diff.unreadable++;
+            continue;
+        }
+        diff.untracked.push_back({std::move(keys[i]), files[i]->size, files[i]->mtime});
+    }
+    std::stable_sort(diff.untracked.begin(), diff.untracked.end(), [](const Untracked& a, const Untracked& b){
+        return a.mtime < b.mtime;
+    });
+}
+
+Reconciler::Diff Reconciler::run(const std::vector<Row>& rows){
+    auto start = std::chrono::steady_clock::now();
+    Diff diff;
+    auto files = walk();
+    diff.files = files.size();
+    for(auto& it : files)diff.bytes += it.size;
+
+    std::vector<std::string> keys;
+    std::vector<std::string_view> views;
+    keys.reserve(rows.size());
+    views.reserve(rows.size());
+    for(auto& it : rows){
+        keys.push_back(cache_key(key_prefix, it.key));
+        views.push_back(keys.back());
+    }
+    std::vector<Md5Digest> digests;
+    md5_batch(views, digests);
+    std::vector<std::string>().swap(keys);
+    std::vector<size_t> order(rows.size());
+    for(size_t i = 0; i < order.size(); i++)order[i] = i;
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b){
+        return digests[a] < digests[b];
+    });
+
+    std::vector<const File*> untracked;
+    size_t f = 0;
+    for(size_t r = 0; r < order.size(); r++){
+        auto& digest = digests[order[r]];
+        for(; f < files.size() && files[f].digest < digest; f++)untracked.push_back(&files[f]);
+        auto& row = rows[order[r]];
+        if(f < files.size() && files[f].digest == digest){
+            if(files[f].size && files[f].size != row.size)diff.resized.push_back({row.key, files[f].size});
+            f++;
+        }else{
+            diff.phantoms.push_back(row.key);
+        }
+    }
+    for(; f < files.size(); f++)untracked.push_back(&files[f]);
+    read_keys(untracked, diff);
+
+    diff.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cerr << "reconciler: " << diff.files << " files, " << rows.size() << " rows in " << diff.seconds
+    << "s: " << diff.phantoms.size() << " phantoms, " << diff.resized.size() << " resized, "
+    << diff.untracked.size() << " untracked, " << diff.unreadable << " unreadable" << std::endl;
+    return diff;
+}
@@ -0,0 +1,74 @@
+/*
+ * Startup reconciliation of the cache directory with the policy database
+ * The tree is walked with statx (CacheWalker, a thread per first level
+ * directory), the files are sorted by name and merged with the rows,
+ * sorted by the md5 of their proxy_cache_key:
+ *   phantom:   a row without a file (removed behind the manager's back)
+ *   resized:   a row whose size is not the bytes taken on disk
+ *   untracked: a file without a row, its key is read from the header
+ *              (files without a readable key are left to the GC)
+ * Temp files and variants ("<md5>.<suffix>") are not counted.
+ *
+ * A file costs 32 bytes until the merge and only the differences are
+ * returned, so a tree of several million files fits in a few hundred MB
+ * and the walk is bound by statx, not by the comparison.
+ */
+
+#ifndef RECONCILER_H
+#define RECONCILER_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cache_path.h"
+#include "cache_walker.h"
+#include "md5.h"
+
+#define RECONCILE_THREADS 16     //one per first level directory with levels=1:...
+
+class Reconciler{
+public:
+    struct Row{
+        std::string key;
+        uint64_t size;
+    };
+    struct Untracked{
+        std::string key;
+        uint64_t size;
+        int64_t mtime;
+    };
+    struct Diff{
+        std::vector<std::string> phantoms;
+        std::vector<Row> resized;          //with the size on disk
+        std::vector<Untracked> untracked;  //oldest first
+        uint64_t files = 0, bytes = 0;     //cache files on disk
+        uint64_t unreadable = 0;           //untracked, no key in the header
+        double seconds = 0;
+    };
+
+    Reconciler(const CachePath& cache_path, const std::string& key_prefix = "",
+               size_t threads = RECONCILE_THREADS);
+
+    Diff run(const std::vector<Row>& rows);
+
+private:
+    const CachePath cache_path;
+    const std::string key_prefix;
+    const size_t threads;
+
+    struct File{
+        Md5Digest digest;
+        uint64_t size;                     //allocated bytes
+        int64_t mtime;
+    };
+
+    std::vector<File> walk();
+    void read_keys(const std::vector<const File*>& files, Diff& diff);
+};
+
+#endif
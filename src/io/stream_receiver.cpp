@@ -0,0 +1,253 @@
+#include "stream_receiver.h"
+
+#define OCTET_HEADER_MAX 16 //"LEN SP", LEN has at most 10 digits
+
+StreamReceiver::StreamReceiver(const std::string& socket, const std::string& owner, const std::string& group, const int& perms,
+                               const std::shared_ptr<Logger>& logger, size_t frame_max, size_t conns_max)
+: socket_path(socket), socket_owner(owner), socket_group(group), socket_perms(perms),
+  logger(logger), frame_max(frame_max), conns_max(conns_max){
+    is_running.store(false), thread_running.store(false);
+    if(socket_path.empty() || socket_owner.empty() || socket_group.empty() || socket_perms < 0 || socket_perms > 511)throw std::runtime_error("manager: invalid args");
+    if(frame_max == 0 || conns_max == 0)throw std::runtime_error("manager: invalid args");
+}
+
+StreamReceiver::~StreamReceiver(){
+    if(io == nullptr)return;
+    work_guard->reset();
+    io->stop();
+    while(thread_running.load())std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    asio::error_code err;
+    acceptor->close(err);
+    for(auto& it : conns)it->sock.close(err);
+    conns.clear();
+    acceptor.reset();
+    io.reset(); //destroys the pending handlers (and the connections they hold)
+
+    if(unlink(socket_path.c_str()))std::cerr << "manager: fail to unlink socket" << std::endl;
+}
+
+void StreamReceiver::init(const BatchCallBack& cb, int framing, bool strip_syslog){
+    if(io != nullptr)throw std::runtime_error("manager: stream receiver already initialized");
+    if(framing < FRAME_AUTO || framing > FRAME_OCTET)throw std::runtime_error("manager: invalid framing");
+    callback = cb;
+    framing_mode = framing;
+    this->strip_syslog = strip_syslog;
+
+    if(unlink(socket_path.c_str()) && errno != ENOENT)throw std::runtime_error("manager: fail to unlink socket");
+    io = std::make_unique<io_context>();
+    work_guard = std::make_unique<WorkGuard>(asio::make_work_guard(*io));
+    try{
+        acceptor = std::make_unique<stream_protocol::acceptor>(*io, stream_protocol::endpoint(socket_path));
+    }catch(const std::exception& e){
+        throw std::runtime_error(std::string("manager: fail to bind socket: ") + e.what());
+    }//open + bind + listen
+
+    Receiver::chown_chmod(socket_path, socket_owner, socket_group, socket_perms);
+}
+
+bool StreamReceiver::now_running() const{
+    return is_running.load() && thread_running.load();
+}
+
+size_t StreamReceiver::connections() const{
+    return conn_count.load();
+}
+
+uint64_t StreamReceiver::frames() const{
+    return frame_count.load();
+}
+
+uint64_t StreamReceiver::oversized() const{
+    return oversized_count.load();
+}
+
+void StreamReceiver::io_run(){
+    if(io == nullptr)throw std::runtime_error("manager: fail to start io (not initialized)");
+    if(thread_running.load())throw std::runtime_error("manager: fail to start io (already start)");
+    thread_running.store(true);
+    io_thread = std::thread([this]() {io->run(); thread_running.store(false);});
+    io_thread.detach();
+}
+
+void StreamReceiver::receive_start(){
+    if(io == nullptr)throw std::runtime_error("manager: fail to start receiving (not initialized)");
+    if(is_running.load())throw std::runtime_error("manager: fail to start receiving (already start)");
+    asio::post(*io, [this]{accept();});
+    is_running.store(true);
+}
+
+void StreamReceiver::receive_stop(){
+    if(!is_running)throw std::runtime_error("manager: fail to stop receiving (already stop)");
+    asio::post(*io, [this]{
+        asio::error_code err;
+        acceptor->cancel(err);
+        for(auto& it : conns)it->sock.close(err);
+        conns.clear();
+        conn_count = 0;
+    });//the connections are only touched by the io thread
+    is_running.store(false);
+}
+
+void StreamReceiver::warn(const std::string& msg){
+    if(logger)logger->put_warn(LOG_ZONE_REVEIVER, msg);
+    else std::cerr << "manager: " << msg << std::endl;
+}
+
+void StreamReceiver::accept(){
+    acceptor->async_accept(
+        [this](const asio::error_code& err, stream_protocol::socket sock){
+            if(err == asio::error::operation_aborted)return;
+            if(err){
+                warn("fail to accept connection: " + err.message());
+            }else if(conns.size() >= conns_max){
+                asio::error_code ec;
+                sock.close(ec);
+                warn("too many connections, rejected");
+            }else{
+                auto conn = std::make_shared<Connection>(std::move(sock), frame_max + OCTET_HEADER_MAX, framing_mode);
+                conns.insert(conn);
+                conn_count = conns.size();
+                read(conn);
+            }
+            accept();
+        }
+    );
+}
+
+void StreamReceiver::read(const ConnPtr& conn){
+    auto& buffer = conn->buffer;
+    conn->sock.async_read_some(
+        asio::buffer(buffer.data() + conn->tail, buffer.size() - conn->tail),
+        [this, conn](const asio::error_code& err, std::size_t recv_bytes){
+            if(err == asio::error::operation_aborted)return;
+            if(err == asio::error::eof){
+                split(*conn, true); //the last line may have no '\n'
+                close(conn);
+                return;
+            }
+            if(err){
+                warn("fail to receive data: " + err.message());
+                close(conn);
+                return;
+            }
+
+            conn->tail += recv_bytes;
+            if(!split(*conn, false)){
+                warn("malformed octet-counting frame, connection closed");
+                close(conn);
+                return;
+            }
+            read(conn);
+        }
+    );
+}
+
+void StreamReceiver::close(const ConnPtr& conn){
+    asio::error_code err;
+    conn->sock.close(err);
+    conns.erase(conn);
+    conn_count = conns.size();
+}
+
+void StreamReceiver::emit(const char* data, size_t len){
+    std::string_view frame(data, len);
+    if(strip_syslog)frame = syslog_payload(frame);
+    if(frame.empty())return;
+    views.push_back(frame);
+}
+
+/*
+ * Split the complete frames in [0, tail) and deliver them in one batch,
+ * then move the incomplete tail (if any) to the front of the buffer.
+ * Return false on a framing error (the stream can't be resynced).
+ */
+bool StreamReceiver::split(Connection& conn, bool eof){
+    char* base = conn.buffer.data();
+    const size_t tail = conn.tail;
+    size_t pos = 0;
+    bool ok = true;
+    views.clear();
+
+    while(pos < tail){
+        if(conn.skip){
+            size_t len = std::min(conn.skip, tail - pos);
+            conn.skip -= len;
+            pos += len;
+            continue;
+        }
+        if(conn.framing == FRAME_AUTO){
+            conn.framing = base[pos] >= '0' && base[pos] <= '9' ? FRAME_OCTET : FRAME_NEWLINE;
+        }//a syslog message starts with '<', a JSON line with '{'
+
+        if(conn.framing == FRAME_OCTET){
+            size_t header = pos, avail = std::min(tail - pos, static_cast<size_t>(OCTET_HEADER_MAX));
+            auto *space = static_cast<char*>(std::memchr(base + pos, ' ', avail));
+            if(space == nullptr){
+                if(avail == OCTET_HEADER_MAX)ok = false;
+                break;
+            }
+            size_t len = 0;
+            auto res = std::from_chars(base + pos, space, len);
+            if(res.ec != std::errc() || res.ptr != space){
+                ok = false;
+                break;
+            }
+
+            size_t start = space + 1 - base;
+            if(len > frame_max){
+                oversized_count++;
+                conn.skip = len;
+                pos = start;
+                continue;
+            }
+            if(start + len > tail){
+                pos = header; //incomplete, keep the header for the next round
+                break;
+            }
+            emit(base + start, len);
+            pos = start + len;
+            continue;
+        }
+
+        auto *newline = static_cast<char*>(std::memchr(base + pos, '\n', tail - pos));
+        if(conn.discarding){
+            if(newline == nullptr){
+                pos = tail;
+                break;
+            }
+            conn.discarding = false;
+            pos = newline + 1 - base;
+            continue;
+        }
+        if(newline == nullptr){
+            if(eof){
+                size_t len = tail - pos;
+                if(base[tail - 1] == '\r')len--;
+                emit(base + pos, len);
+                pos = tail;
+            }
+            break;
+        }
+        size_t len = newline - (base + pos);
+        if(len && base[pos + len - 1] == '\r')len--;
+        if(len > frame_max)oversized_count++;
+        else emit(base + pos, len);
+        pos = newline + 1 - base;
+    }
+
+    frame_count += views.size();
+    if(views.size())callback(std::span<std::string_view>(views.data(), views.size()));
+
+    size_t rest = tail - pos;
+    if(conn.framing != FRAME_OCTET && rest > frame_max){
+        //a line longer than frame_max, drop it until the next '\n'
+        oversized_count++;
+        conn.discarding = true;
+        rest = 0;
+    }else if(rest && pos){
+        std::memmove(base, base + pos, rest);
+    }
+    conn.tail = rest;
+    return ok;
+}
@@ -0,0 +1,110 @@
+/*
+ * Stream (SOCK_STREAM) log receiver
+ * Accept any number of local connections (rsyslog/syslog-ng relays, or
+ * a sidecar forwarding nginx logs), so a log line is no longer limited
+ * to one datagram of BUFFER_SIZE.
+ *
+ * Every connection owns one reusable buffer, the frames are split in
+ * place and handed to the callback as views (the same BatchCallBack as
+ * Receiver::init_batch), only the tail of an incomplete frame is moved
+ * to the front after each read.
+ *
+ * Framing (RFC 6587):
+ *   FRAME_NEWLINE  "MSG\n", an optional '\r' is stripped
+ *   FRAME_OCTET    "LEN SP MSG" (octet-counting)
+ *   FRAME_AUTO     decided by the first byte of a connection
+ * With strip_syslog the RFC 3164/5424 header is skipped (see syslog.h).
+ */
+
+#ifndef STREAM_RECEIVER_H
+#define STREAM_RECEIVER_H
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cstring>
+#include <memory>
+#include <unordered_set>
+
+#include <asio/local/stream_protocol.hpp>
+
+#include "receiver.h"
+#include "syslog.h"
+
+#define STREAM_FRAME_MAX  65536 //longer frames are dropped
+#define STREAM_CONNS_MAX  64
+
+using asio::local::stream_protocol;
+
+class StreamReceiver{
+public:
+     using BatchCallBack = Receiver::BatchCallBack;
+     //the views point into the connection buffer, only valid inside the callback
+
+     enum {
+          FRAME_AUTO,
+          FRAME_NEWLINE,
+          FRAME_OCTET
+     };
+
+     StreamReceiver(const std::string& socket, const std::string& owner, const std::string& group, const int& perms,
+                    const std::shared_ptr<Logger>& logger = nullptr, size_t frame_max = STREAM_FRAME_MAX,
+                    size_t conns_max = STREAM_CONNS_MAX);
+     ~StreamReceiver();
+     void init(const BatchCallBack& cb, int framing = FRAME_AUTO, bool strip_syslog = true);
+     void io_run();
+     void receive_start();
+     void receive_stop();
+     bool now_running() const;
+
+     size_t connections() const;
+     uint64_t frames() const;
+     uint64_t oversized() const;     //frames dropped for exceeding frame_max
+
+
+private:
+     struct Connection{
+          Connection(stream_protocol::socket&& sock, size_t capacity, int framing) :
+                     sock(std::move(sock)), buffer(capacity), framing(framing) {}
+          stream_protocol::socket sock;
+          std::vector<char> buffer;
+          size_t tail = 0;             //bytes in buffer
+          size_t skip = 0;             //octet-counting: bytes left of an oversized frame
+          bool discarding = false;     //newline: drop until the next '\n'
+          int framing;
+     };
+     using ConnPtr = std::shared_ptr<Connection>;
+
+     const std::string socket_path;
+     const std::string socket_owner;
+     const std::string socket_group;
+     const int socket_perms;
+     std::shared_ptr<Logger> logger;
+     const size_t frame_max, conns_max;
+
+     BatchCallBack callback;
+     int framing_mode = FRAME_AUTO;
+     bool strip_syslog = true;
+     std::vector<std::string_view> views;     //reused, io thread only
+     std::unordered_set<ConnPtr> conns;       //io thread only
+
+     std::atomic<size_t> conn_count = 0;
+     std::atomic<uint64_t> frame_count = 0, oversized_count = 0;
+
+     using WorkGuard = asio::executor_work_guard<io_context::executor_type>;
+     std::unique_ptr<io_context> io;
+     std::unique_ptr<WorkGuard> work_guard;
+     std::unique_ptr<stream_protocol::acceptor> acceptor;
+
+     std::thread io_thread;
+     std::atomic<bool> thread_running, is_running;
+
+     void accept();
+     void read(const ConnPtr& conn);
+     bool split(Connection& conn, bool eof);
+     void emit(const char* data, size_t len);
+     void close(const ConnPtr& conn);
+     void warn(const std::string& msg);
+};
+
+#endif
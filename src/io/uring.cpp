@@ -0,0 +1,111 @@
+#include "uring.h"
+
+Uring::Uring(unsigned entries){
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    ring_fd = syscall(__NR_io_uring_setup, entries, &params);
+    if(ring_fd < 0)throw std::runtime_error(std::string("uring: setup: ") + strerror(errno));
+
+    sq_entries = params.sq_entries;
+    cq_entries = params.cq_entries;
+    sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    if(params.features & IORING_FEAT_SINGLE_MMAP)sq_size = cq_size = std::max(sq_size, cq_size);
+
+    sq_ptr = mmap(nullptr, sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+    if(sq_ptr == MAP_FAILED){
+        sq_ptr = nullptr;
+        cleanup();
+        throw std::runtime_error(std::string("uring: mmap: ") + strerror(errno));
+    }
+    if(params.features & IORING_FEAT_SINGLE_MMAP){
+        cq_ptr = sq_ptr;
+    }else{
+        cq_ptr = mmap(nullptr, cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+        if(cq_ptr == MAP_FAILED){
+            cq_ptr = nullptr;
+            cleanup();
+            throw std::runtime_error(std::string("uring: mmap: ") + strerror(errno));
+        }
+    }
+    sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    void* ptr = mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+    if(ptr == MAP_FAILED){
+        cleanup();
+        throw std::runtime_error(std::string("uring: mmap: ") + strerror(errno));
+    }
+    sqes = static_cast<io_uring_sqe*>(ptr);
+
+    auto *sq = static_cast<char*>(sq_ptr), *cq = static_cast<char*>(cq_ptr);
+    sq_head = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sq_mask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cq_mask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+}
+
+Uring::~Uring(){
+    cleanup();
+}
+
+void Uring::cleanup(){
+    if(sqes != nullptr)munmap(sqes, sqes_size);
+    if(cq_ptr != nullptr && cq_ptr != sq_ptr)munmap(cq_ptr, cq_size);
+    if(sq_ptr != nullptr)munmap(sq_ptr, sq_size);
+    if(ring_fd >= 0)close(ring_fd);
+    sqes = nullptr;
+    sq_ptr = cq_ptr = nullptr;
+    ring_fd = -1;
+}
+
+bool Uring::supported(std::initializer_list<int> ops){
+    try{
+        Uring ring(2);
+        size_t len = sizeof(io_uring_probe) + IORING_OP_LAST * sizeof(io_uring_probe_op);
+        auto *probe = static_cast<io_uring_probe*>(calloc(1, len));
+        if(probe == nullptr)return false;
+        bool res = syscall(__NR_io_uring_register, ring.ring_fd, IORING_REGISTER_PROBE, probe, IORING_OP_LAST) == 0;
+        for(int op : ops){
+            res = res && op <= probe->last_op && (probe->ops[op].flags & IO_URING_OP_SUPPORTED);
+        }
+        free(probe);
+        return res;
+    }catch(const std::exception& e){
+        return false;
+    }
+}
+
+io_uring_sqe* Uring::get_sqe(){
+    unsigned head = __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+    unsigned tail = *sq_tail + pending;
+    if(tail - head >= sq_entries)return nullptr;
+    unsigned index = tail & *sq_mask;
+    io_uring_sqe* sqe = &sqes[index];
+    std::memset(sqe, 0, sizeof(*sqe));
+    sq_array[index] = index;
+    pending++;
+    return sqe;
+}
+
+int Uring::submit(unsigned wait_nr){
+    unsigned count = pending;
+    if(count)__atomic_store_n(sq_tail, *sq_tail + count, __ATOMIC_RELEASE);
+    pending = 0;
+    if(count == 0 && wait_nr == 0)return 0;
+    int res;
+    do{
+        res = syscall(__NR_io_uring_enter, ring_fd, count, wait_nr, wait_nr ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+    }while(res < 0 && errno == EINTR);
+    return res < 0 ? -errno : res;
+}
+
+bool Uring::peek(io_uring_cqe& cqe){
+    unsigned head = *cq_head;
+    if(head == __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE))return false;
+    cqe = cqes[head & *cq_mask];
+    __atomic_store_n(cq_head, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
@@ -0,0 +1,54 @@
+/*
+ * Minimal io_uring ring on the raw syscalls (no liburing)
+ * Only what the deleter needs: get an SQE, submit and wait, reap the
+ * CQEs. One ring per thread, it is not thread-safe.
+ */
+
+#ifndef URING_H
+#define URING_H
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+#include <stdexcept>
+#include <string>
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#define URING_DEPTH 256
+
+class Uring{
+public:
+    explicit Uring(unsigned entries = URING_DEPTH);
+    ~Uring();
+    Uring(const Uring&) = delete;
+    Uring& operator=(const Uring&) = delete;
+
+    static bool supported(std::initializer_list<int> ops); //kernel knows all of these opcodes
+
+    io_uring_sqe* get_sqe();                 //nullptr if the submission queue is full
+    int submit(unsigned wait_nr = 0);        //returns the SQEs submitted or -errno
+    bool peek(io_uring_cqe& cqe);            //copies and consumes one CQE
+    unsigned depth() const{return sq_entries;}
+
+private:
+    int ring_fd = -1;
+    unsigned sq_entries = 0, cq_entries = 0;
+    void *sq_ptr = nullptr, *cq_ptr = nullptr;
+    size_t sq_size = 0, cq_size = 0, sqes_size = 0;
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    io_uring_sqe* sqes = nullptr;
+    io_uring_cqe* cqes = nullptr;
+    unsigned pending = 0;                    //queued, not yet submitted
+
+    void cleanup();
+};
+
+#endif
@@ -89,6 +89,66 @@ public:
         return vec;
     }
 
+    template<typename T>
+    std::vector<std::variant<T, RedisReplyNil, RedisReplyError>> command_multi_argv(const std::vector<std::string>& argv){
+        Reply reply = command_argv_impl(argv);
+        
+        if(reply->type != REDIS_REPLY_ARRAY){
+            return {reply_proc<T>(reply.get())};
+        }
+
+        std::vector<std::variant<T, RedisReplyNil, RedisReplyError>> vec;
+        vec.reserve(reply->elements);
+        for(size_t i = 0; i < reply->elements; i++){
+            vec.push_back(reply_proc<T>(reply->element[i]));
+        }
+
+        return vec;
+    }
+
+
+    template<typename T>
+    std::vector<std::variant<T, RedisReplyNil, RedisReplyError>> pipeline_single(const std::vector<std::vector<std::string>>& cmds){
+        auto replies = pipeline_impl(cmds);
+        std::vector<std::variant<T, RedisReplyNil, RedisReplyError>> vec;
+        vec.reserve(replies.size());
+        for(auto& it : replies){
+            vec.push_back(reply_proc<T>(it.get()));
+        }
+        return vec;
+    }
+
+    //one step of SCAN, return the next cursor ("0" when finished)
+    std::string scan(const std::string& cursor, const std::string& pattern,
+                     size_t count, std::vector<std::string>& keys,
+                     const std::string& type = ""){
+        std::vector<std::string> argv = {"SCAN", cursor, "MATCH", pattern,
+                                         "COUNT", std::to_string(count)};
+        if(type.size()){
+            argv.emplace_back("TYPE");
+            argv.emplace_back(type);
+        }
+        
+        Reply reply = command_argv_impl(argv);
+        if(reply->type == REDIS_REPLY_ERROR){
+            throw RedisError("scan error: " + std::string(reply->str, reply->len));
+        }
+        
+        if(reply->type != REDIS_REPLY_ARRAY || reply->elements != 2 ||
+           reply->element[0]->type != REDIS_REPLY_STRING ||
+           reply->element[1]->type != REDIS_REPLY_ARRAY){
+            throw RedisError("scan unexpected reply type: " + std::to_string(reply->type));
+        }
+
+        auto list = reply->element[1];
+        keys.clear();
+        keys.reserve(list->elements);
+        for(size_t i = 0; i < list->elements; i++){
+            keys.emplace_back(list->element[i]->str, list->element[i]->len);
+        }
+        return std::string(reply->element[0]->str, reply->element[0]->len);
+    }
+
 
     template<typename T, typename... Args>
     static const std::string serialize(const T& first, const Args&... rest){
@@ -128,6 +188,40 @@ private:
         return reply;
     }
 
+    Reply command_argv_impl(const std::vector<std::string>& argv){
+        Reply reply;
+        try{
+            reply = command_argv(argv);
+        }catch(const std::runtime_error& e){
+            if(upper_retry)logger->put_error(LOG_ZONE_REDIS, e.what());
+            else throw;
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(upper_retry_interval));
+
+            logger->put_warn(LOG_ZONE_REDIS, "command retry by adapter");
+            if(!connected)reset();
+            reply = command_argv(argv);
+        }
+        return reply;
+    }
+
+    std::vector<Reply> pipeline_impl(const std::vector<std::vector<std::string>>& cmds){
+        std::vector<Reply> replies;
+        try{
+            replies = pipeline_argv(cmds);
+        }catch(const std::runtime_error& e){
+            if(upper_retry)logger->put_error(LOG_ZONE_REDIS, e.what());
+            else throw;
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(upper_retry_interval));
+
+            logger->put_warn(LOG_ZONE_REDIS, "pipeline retry by adapter");
+            if(!connected)reset();
+            replies = pipeline_argv(cmds);
+        }
+        return replies;
+    }
+
     template<typename T>
     std::variant<T, RedisReplyNil, RedisReplyError> reply_proc(const redisReply* reply){
         if(reply->type == REDIS_REPLY_NIL){
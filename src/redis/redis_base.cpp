@@ -99,3 +99,84 @@ std::string RedisBase::proc_error(int flag, const std::string& error_pre){
     return error_msg;
 }
 
+RedisBase::Reply RedisBase::command_argv(const std::vector<std::string>& argv){
+    if(argv.empty())throw RedisError("command exception: empty argv");
+    
+    std::vector<const char*> args(argv.size());
+    std::vector<size_t> lens(argv.size());
+    for(size_t i = 0; i < argv.size(); i++){
+        args[i] = argv[i].data();
+        lens[i] = argv[i].size();
+    }
+
+    redisReply* reply;
+    for(int i = 1; i <= max_tries; i++){
+        reply = static_cast<redisReply*>(redisCommandArgv(redis_ctx, args.size(),
+                                         args.data(), lens.data()));
+        if(reply != NULL){
+            return Reply(reply, redisReplyDelete());
+        }
+
+        proc_error(EXCEPT_PRINT, "command (" + argv[0] + ") error: ");
+        if(i == max_tries){
+            proc_error(EXCEPT_THROW, "command (" + argv[0] + ") exception: ");
+        }
+
+        std::this_thread::sleep_for(retry_interval);
+        if(redis_ctx->err == REDIS_ERR_IO || redis_ctx->err == REDIS_ERR_EOF){
+            reconnect();
+        }
+
+        logger->put_warn(LOG_ZONE_REDIS, "command retry: #", i);
+    }
+    return nullptr;
+}
+
+std::vector<RedisBase::Reply> RedisBase::pipeline_argv(const std::vector<std::vector<std::string>>& cmds){
+    std::vector<Reply> replies;
+    if(cmds.empty())return replies;
+    
+    std::vector<const char*> args;
+    std::vector<size_t> lens;
+    for(int i = 1; i <= max_tries; i++){
+        bool ok = true;
+        for(auto& argv : cmds){
+            if(argv.empty())throw RedisError("pipeline exception: empty argv");
+            args.resize(argv.size());
+            lens.resize(argv.size());
+            for(size_t j = 0; j < argv.size(); j++){
+                args[j] = argv[j].data();
+                lens[j] = argv[j].size();
+            }
+            if(redisAppendCommandArgv(redis_ctx, args.size(), args.data(),
+                                      lens.data()) != REDIS_OK){
+                ok = false;
+                break;
+            }
+        }
+
+        replies.clear();
+        replies.reserve(cmds.size());
+        while(ok && replies.size() < cmds.size()){
+            void* reply = NULL;
+            if(redisGetReply(redis_ctx, &reply) != REDIS_OK || reply == NULL){
+                ok = false;
+                break;
+            }
+            replies.emplace_back(static_cast<redisReply*>(reply), redisReplyDelete());
+        }
+        if(ok)return replies;
+
+        proc_error(EXCEPT_PRINT, "pipeline (" + std::to_string(cmds.size()) + " cmds) error: ");
+        if(i == max_tries){
+            proc_error(EXCEPT_THROW, "pipeline exception: ");
+        }
+
+        std::this_thread::sleep_for(retry_interval);
+        reconnect(); //the context is unusable with replies pending
+        
+        logger->put_warn(LOG_ZONE_REDIS, "pipeline retry: #", i);
+    }
+    return replies;
+}
+
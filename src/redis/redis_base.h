@@ -17,6 +17,7 @@
 #include <thread>
 #include <functional>
 #include <utility>
+#include <vector>
 #include <hiredis/hiredis.h>
 
 #include "logger.h"
@@ -93,6 +94,13 @@ public:
         }
     }
 
+    //binary-safe version, every element of argv is one argument
+    Reply command_argv(const std::vector<std::string>& argv);
+    
+    //send all commands in one round trip, replies are in the same order
+    //the whole pipeline is resent on io error, so keep the commands idempotent
+    std::vector<Reply> pipeline_argv(const std::vector<std::vector<std::string>>& cmds);
+
 
 private:
     std::shared_ptr<Logger> logger;
@@ -0,0 +1,93 @@
+#include "redis_evict_batcher.h"
+#include "redis_subscriber.h"
+
+EvictBatcher::EvictBatcher(FlushCallback cb, const std::shared_ptr<Logger>& logger,
+size_t batch_max, int flush_interval) : flush_callback(cb), logger(logger),
+batch_max(batch_max), flush_interval(flush_interval), buffer_used(0),
+stop_signal(false), flushed_keys(0), flush_times(0){
+    if(batch_max == 0 || flush_interval <= 0)throw std::runtime_error("batcher: invalid args");
+    buffer.resize(batch_max);
+    flushing.resize(batch_max);
+}
+
+EvictBatcher::~EvictBatcher(){
+    stop();
+}
+
+void EvictBatcher::run(){
+    if(worker_thread.joinable())throw std::runtime_error("batcher: already running");
+    stop_signal = false;
+    worker_thread = std::thread(&EvictBatcher::worker, this);
+}
+
+void EvictBatcher::stop(){
+    if(!worker_thread.joinable())return;
+
+    buffer_lock.lock();
+    stop_signal = true;
+    buffer_lock.unlock();
+    cv.notify_one();
+
+    worker_thread.join();
+    logger->put_info(LOG_ZONE_REDIS, "eviction batcher stopped, flushed keys: ",
+                     flushed_keys.load(), ", batches: ", flush_times.load());
+}
+
+void EvictBatcher::push(std::string_view key){
+    std::unique_lock<std::mutex> lock(buffer_lock);
+    if(buffer_used == buffer.size())buffer.emplace_back();
+    //flushing is slow, keep accepting instead of blocking the event loop
+
+    buffer[buffer_used++].assign(key);
+    if(buffer_used == batch_max){
+        lock.unlock();
+        cv.notify_one();
+    }
+}
+
+void EvictBatcher::on_message(std::string_view channel, std::string_view message){
+    if(channel != CHANNEL){
+        logger->put_debug(LOG_ZONE_REDIS, "batcher: ignore message from ", channel);
+        return;
+    }
+    push(message);
+}
+
+size_t EvictBatcher::pending() const{
+    std::lock_guard<std::mutex> lock(buffer_lock);
+    return buffer_used;
+}
+
+uint64_t EvictBatcher::flushed() const{
+    return flushed_keys.load();
+}
+
+void EvictBatcher::worker(){
+    while(true){
+        std::unique_lock<std::mutex> lock(buffer_lock);
+        cv.wait_for(lock, flush_interval,
+                    [this]{return stop_signal || buffer_used >= batch_max;});
+
+        bool quit = stop_signal;
+        size_t count = buffer_used;
+        if(count){
+            if(flushing.size() < buffer.size())flushing.resize(buffer.size());
+            buffer.swap(flushing);
+            buffer_used = 0;
+        }
+        lock.unlock();
+
+        if(count){
+            try{
+                flush_callback(std::span<std::string>(flushing.data(), count));
+            }catch(const std::exception& e){
+                logger->put_error(LOG_ZONE_REDIS, "batcher: flush failed: ", e.what(),
+                                  ", lost keys: ", count);
+            }
+            flushed_keys.fetch_add(count);
+            flush_times.fetch_add(1);
+        }
+
+        if(quit)return;
+    }
+}
@@ -0,0 +1,72 @@
+/*
+ * Batching consumer for the eviction events from redis keyspace notification
+ * When redis evicts under maxmemory, it publishes one message per key, which
+ * turns into a storm of callbacks. The keys are collected into a reusable
+ * buffer and flushed to the policy layer once batch_max keys are pending or
+ * flush_interval has passed, whichever comes first.
+ *
+ * push() is called from the subscriber event loop, the flush callback is
+ * called from the batcher thread (never concurrently with itself).
+ */
+
+#ifndef REDIS_EVICT_BATCHER_H
+#define REDIS_EVICT_BATCHER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "logger.h"
+#include "logging_zones.h"
+
+#define BATCH_MAX    512
+#define FLUSH_INTVL  100 //ms
+
+class EvictBatcher{
+public:
+    using FlushCallback = std::function<void(std::span<std::string> keys)>;
+    //the strings may be moved out, the buffer is reused after return
+
+    EvictBatcher(FlushCallback cb, const std::shared_ptr<Logger>& logger,
+                 size_t batch_max = BATCH_MAX, int flush_interval = FLUSH_INTVL);
+    ~EvictBatcher();
+
+    void run();
+    void stop(); //flush the remaining keys and quit
+
+    void push(std::string_view key);
+    void on_message(std::string_view channel, std::string_view message);
+    //can be used as SubManager::MessageCallback
+
+    size_t pending() const;
+    uint64_t flushed() const;
+
+private:
+    FlushCallback flush_callback;
+    std::shared_ptr<Logger> logger;
+    const size_t batch_max;
+    const std::chrono::milliseconds flush_interval;
+
+    //double buffer, the strings keep their capacity between flushes
+    std::vector<std::string> buffer, flushing;
+    size_t buffer_used;
+
+    mutable std::mutex buffer_lock;
+    std::condition_variable cv;
+    std::atomic<bool> stop_signal;
+    std::atomic<uint64_t> flushed_keys, flush_times;
+    std::thread worker_thread;
+
+    void worker();
+};
+
+#endif
@@ -206,6 +206,10 @@ int SubManager::subscribe(){
     
 }
 
+void SubManager::set_message_callback(MessageCallback cb){
+    message_callback = cb;
+}
+
 void SubManager::connect_callback(int res, const std::string& msg){
     if(res == REDIS_OK){
         logger->put_info(LOG_ZONE_REDIS, msg);
@@ -227,6 +231,17 @@ void SubManager::disconnect_callback(int res, const std::string& msg){
     }
 }
 
+bool SubManager::is_message(const redisReply* reply){
+    //["message", channel, payload] or ["pmessage", pattern, channel, payload]
+    if(reply->elements != 3 && reply->elements != 4)return false;
+    for(size_t i = 0; i < reply->elements; i++){
+        if(reply->element[i]->type != REDIS_REPLY_STRING)return false;
+    }
+    
+    std::string_view kind(reply->element[0]->str, reply->element[0]->len);
+    return reply->elements == 3 ? kind == "message" : kind == "pmessage";
+}
+
 void SubManager::command_callback(redisAsyncContext *ctx,
                                   void *r, void *privdata){
     if(r == NULL)return;
@@ -245,6 +260,14 @@ void SubManager::command_callback(redisAsyncContext *ctx,
                 {{std::string(reply->str, reply->len)}});
     
     }else if(reply->type == REDIS_REPLY_ARRAY){
+        if(manager->message_callback && is_message(reply)){
+            auto channel = reply->element[reply->elements - 2];
+            auto message = reply->element[reply->elements - 1];
+            manager->message_callback(std::string_view(channel->str, channel->len),
+                                      std::string_view(message->str, message->len));
+            return;
+        }
+        
         std::vector<std::string> vec(reply->elements);
         for(size_t i = 0; i < reply->elements; i++){
             if(reply->element[i]->type == REDIS_REPLY_INTEGER){
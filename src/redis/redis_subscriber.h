@@ -12,6 +12,7 @@
 #include <memory>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <thread>
 #include <mutex>
 #include <ratio>
@@ -88,6 +89,9 @@ public:
     using Reply = std::variant<RedisReplyStringArray,
                                RedisReplyStatus, RedisReplyError>;
     using SubCallback = std::function<void(Reply)>;
+    using MessageCallback = std::function<void(std::string_view channel,
+                                               std::string_view message)>;
+    //the views are only valid inside the callback
     
     SubManager(SubCallback sub_callback, const std::shared_ptr<Logger>& logger,
                const std::string& host, int port = PORT,
@@ -103,6 +107,8 @@ public:
     void connect();
     int subscribe();
     //you must call disconnect() and wait connect() for exit
+    void set_message_callback(MessageCallback cb);
+    //published messages bypass sub_callback (no copy), set it before connect()
 
     void connect_callback(int res, const std::string& msg);
     void disconnect_callback(int res, const std::string& msg);
@@ -113,6 +119,7 @@ private:
     std::string host, source_addr;
     int port, connect_timeout;
     SubCallback sub_callback;
+    MessageCallback message_callback;
 
     std::condition_variable cv;
     std::mutex connect_lock;
@@ -124,4 +131,5 @@ private:
     RedisSub* redis;
 
     void free();
+    static bool is_message(const redisReply* reply);
 };
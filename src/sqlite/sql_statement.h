@@ -75,6 +75,19 @@
                            "RETURNING key, size, download_time, " \
                            "hash, sequence;"
 
+#define SQL_QUERY_KEYS_LRU "SELECT key, size FROM cacheLRU " \
+                           "ORDER BY key ASC;"
+
+#define SQL_QUERY_SIZE_LRU "SELECT COALESCE(SUM(size), 0) " \
+                           "FROM cacheLRU;"
+
+#define SQL_DELETE_KEY_LRU "DELETE FROM cacheLRU WHERE key = ?;"
+
+/*------------------------------------------------------------------*/
+#define SQL_BEGIN    "BEGIN IMMEDIATE;"
+#define SQL_COMMIT   "COMMIT;"
+#define SQL_ROLLBACK "ROLLBACK;"
+
 /*------------------------------------------------------------------*/
 #define SQL_CREATE_METALFUDA "CREATE TABLE metaLFUDA (" \
                              "id INTEGER PRIMARY KEY CHECK (id = 1), " \
@@ -0,0 +1,133 @@
+/*
+ * Fixed-size buffer pool with lease semantics
+ * All slots are allocated once, acquire() hands out a Lease which gives
+ * the slot back to the pool when it is destroyed, so a message can travel
+ * from the socket to the parser without any heap allocation.
+ *
+ * The free list is a lock-free stack (index + tag in one 64-bit word to
+ * avoid ABA), acquire() and release can be called from any thread.
+ * The pool must outlive every lease.
+ */
+
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+
+#define POOL_SLOTS      4096
+#define POOL_SLOT_SIZE  4096
+
+class BufferPool{
+public:
+    class Lease{
+    public:
+        Lease() : pool(nullptr), slot(0), len(0) {}
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+        Lease(Lease&& other) noexcept : pool(std::exchange(other.pool, nullptr)),
+                                        slot(other.slot), len(other.len) {}
+        Lease& operator=(Lease&& other) noexcept{
+            if(this != &other){
+                release();
+                pool = std::exchange(other.pool, nullptr);
+                slot = other.slot;
+                len = other.len;
+            }
+            return *this;
+        }
+        ~Lease(){release();}
+
+        explicit operator bool() const{return pool != nullptr;}
+        char* data() const{return pool->storage.get() + slot * pool->slot_size;}
+        size_t capacity() const{return pool->slot_size;}
+        size_t size() const{return len;}
+        void set_size(size_t size){len = size < capacity() ? size : capacity();}
+        std::string_view view() const{return std::string_view(data(), len);}
+
+        void release(){
+            if(pool == nullptr)return;
+            pool->put(slot);
+            pool = nullptr;
+            len = 0;
+        }
+
+    private:
+        friend class BufferPool;
+        Lease(BufferPool* pool, uint32_t slot) : pool(pool), slot(slot), len(0) {}
+
+        BufferPool* pool;
+        uint32_t slot;
+        size_t len;
+    };
+
+    BufferPool(size_t slots = POOL_SLOTS, size_t slot_size = POOL_SLOT_SIZE) :
+               slots(slots), slot_size(slot_size), free_count(slots){
+        if(slots == 0 || slots >= NIL || slot_size == 0){
+            throw std::runtime_error("buffer pool: invalid args");
+        }
+        storage = std::make_unique<char[]>(slots * slot_size);
+        next = std::make_unique<std::atomic<uint32_t>[]>(slots);
+        for(size_t i = 0; i < slots; i++){
+            next[i].store(i + 1 < slots ? i + 1 : NIL, std::memory_order_relaxed);
+        }
+        head.store(pack(0, 0));
+    }
+
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    Lease acquire(){ //empty lease if exhausted
+        uint64_t old_head = head.load(std::memory_order_acquire);
+        while(true){
+            uint32_t index = static_cast<uint32_t>(old_head);
+            if(index == NIL)return Lease();
+            uint64_t new_head = pack(next[index].load(std::memory_order_relaxed),
+                                     (old_head >> 32) + 1);
+            if(head.compare_exchange_weak(old_head, new_head,
+                                          std::memory_order_acq_rel,
+                                          std::memory_order_acquire)){
+                free_count.fetch_sub(1, std::memory_order_relaxed);
+                return Lease(this, index);
+            }
+        }
+    }
+
+    size_t available() const{return free_count.load(std::memory_order_relaxed);}
+    size_t size() const{return slots;}
+    size_t buffer_size() const{return slot_size;}
+
+private:
+    static constexpr uint32_t NIL = UINT32_MAX;
+
+    const size_t slots, slot_size;
+    std::unique_ptr<char[]> storage;
+    std::unique_ptr<std::atomic<uint32_t>[]> next;
+    std::atomic<uint64_t> head; //tag << 32 | index
+    std::atomic<size_t> free_count;
+
+    static uint64_t pack(uint32_t index, uint64_t tag){
+        return (tag << 32) | index;
+    }
+
+    void put(uint32_t slot){
+        uint64_t old_head = head.load(std::memory_order_relaxed);
+        while(true){
+            next[slot].store(static_cast<uint32_t>(old_head), std::memory_order_relaxed);
+            uint64_t new_head = pack(slot, (old_head >> 32) + 1);
+            if(head.compare_exchange_weak(old_head, new_head,
+                                          std::memory_order_release,
+                                          std::memory_order_relaxed)){
+                free_count.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,104 @@
+/*
+ * Location of an nginx cache file, from its key
+ * nginx names the file after md5(proxy_cache_key) in hex, and the
+ * directories are taken from the end of that name according to levels:
+ *   proxy_cache_path /data/nginx/cache levels=1:2 ...
+ *   md5 b7f54b2df7773722d382f4809d65029c
+ *   ->  /data/nginx/cache/c/29/b7f54b2df7773722d382f4809d65029c
+ *
+ * cache_key() builds proxy_cache_key from a policy key (the request
+ * path) and key_prefix, the part of proxy_cache_key before $request_uri.
+ * read_cache_key() goes the other way, from the "KEY: " line nginx writes
+ * in the header of every cache file.
+ */
+
+#ifndef CACHE_PATH_H
+#define CACHE_PATH_H
+
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "md5.h"
+
+#define DEFAULT_LEVELS "1:2"
+#define CACHE_HEADER   4096      //bytes read for the KEY: line
+
+inline std::string cache_key(const std::string& key_prefix, const std::string& path){
+    if(path.size() && path.front() == '/')return key_prefix + path;
+    return key_prefix + '/' + path;
+}
+
+//the policy key of a cache file, empty if unreadable or not under key_prefix
+inline std::string read_cache_key(const std::string& file, const std::string& key_prefix = ""){
+    int fd = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd < 0)return "";
+    char buf[CACHE_HEADER];
+    ssize_t len = pread(fd, buf, sizeof(buf), 0);
+    close(fd);
+    if(len <= 0)return "";
+    std::string_view header(buf, len);
+    size_t pos = header.find("\nKEY: ");
+    if(pos == std::string_view::npos)return "";
+    pos += 6;
+    size_t end = header.find('\n', pos);
+    if(end == std::string_view::npos)return "";
+    std::string_view key = header.substr(pos, end - pos);
+    if(!key.starts_with(key_prefix))return "";
+    key.remove_prefix(key_prefix.size());
+    return std::string(key);
+}
+
+class CachePath{
+public:
+    CachePath(const std::string& root, const std::string& levels = DEFAULT_LEVELS) : root_dir(root){
+        if(root_dir.empty())throw std::runtime_error("cache_path: empty root");
+        if(root_dir.back() != '/')root_dir += '/';
+        //nginx accepts 1 to 3 levels of 1 or 2 characters
+        for(size_t pos = 0; pos <= levels.size(); pos += 2){
+            if(levels.size() == 0 || (levels[pos] != '1' && levels[pos] != '2') ||
+               (pos + 1 < levels.size() && levels[pos + 1] != ':') || level_len.size() == 3){
+                throw std::runtime_error("cache_path: invalid levels: " + levels);
+            }
+            level_len.push_back(levels[pos] - '0');
+        }
+    }
+
+    std::string path(std::string_view key) const{
+        return path(md5(key));
+    }
+
+    std::string path(const Md5Digest& digest) const{
+        std::string name = md5_hex(digest);
+        std::string res = root_dir;
+        size_t end = name.size();
+        for(auto len : level_len){
+            end -= len;
+            res.append(name, end, len);
+            res += '/';
+        }
+        return res + name;
+    }
+
+    //the keys are hashed md5_lanes() at a time
+    void paths(std::span<const std::string_view> keys, std::vector<std::string>& out) const{
+        std::vector<Md5Digest> digests;
+        md5_batch(keys, digests);
+        out.resize(keys.size());
+        for(size_t i = 0; i < keys.size(); i++)out[i] = path(digests[i]);
+    }
+
+    const std::string& root() const{return root_dir;}
+    const std::vector<int>& levels() const{return level_len;}
+
+private:
+    std::string root_dir;
+    std::vector<int> level_len;
+};
+
+#endif
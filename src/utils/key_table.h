@@ -0,0 +1,91 @@
+/*
+ * Perfect hash table of the requested json_keys (shared by the parsers)
+ * A seed without collisions is searched when it is built, so a lookup
+ * is one FNV-1a hash and one compare. Duplicate keys are resolved to
+ * the first one, copy_aliases() fills the others after parsing.
+ */
+
+#ifndef KEY_TABLE_H
+#define KEY_TABLE_H
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#define KEY_SEED_TRIES 256 //seeds tried before the table is doubled
+
+class KeyTable{
+public:
+    KeyTable(const std::vector<std::string>& keys) : keys(keys){
+        if(keys.empty())throw std::runtime_error("parser: invalid args");
+
+        alias.assign(keys.size(), -1);
+        std::vector<int> unique;
+        for(size_t i = 0; i < keys.size(); i++){
+            for(size_t j = 0; j < i; j++){
+                if(keys[j] == keys[i]){
+                    alias[i] = j;
+                    has_alias = true;
+                    break;
+                }
+            }
+            if(alias[i] < 0)unique.push_back(i);
+        }
+
+        size_t size = 8;
+        while(size < unique.size() * 2)size <<= 1;
+        while(true){
+            for(uint32_t s = 0; s < KEY_SEED_TRIES; s++){
+                if(build(unique, size, s))return;
+            }
+            size <<= 1;
+        }
+    }
+
+    int lookup(std::string_view key) const{ //index in keys, -1 if not requested
+        int idx = table[hash(key, seed) & mask];
+        return idx >= 0 && keys[idx] == key ? idx : -1;
+    }
+
+    template<typename V>
+    void copy_aliases(std::vector<V>& values) const{
+        if(!has_alias)return;
+        for(size_t i = 0; i < alias.size(); i++){
+            if(alias[i] >= 0)values[i] = values[alias[i]];
+        }
+    }
+
+    size_t size() const{return keys.size();}
+
+private:
+    const std::vector<std::string> keys;
+    std::vector<int> table;     //slot -> index of keys, -1 if empty
+    std::vector<int> alias;     //index of the first same key, -1 if unique
+    bool has_alias = false;
+    uint32_t mask = 0, seed = 0;
+
+    static uint32_t hash(std::string_view key, uint32_t seed){
+        uint32_t h = 2166136261u ^ seed; //FNV-1a
+        for(unsigned char c : key){
+            h ^= c;
+            h *= 16777619u;
+        }
+        return h ^ (h >> 15);
+    }
+
+    bool build(const std::vector<int>& unique, size_t size, uint32_t s){
+        table.assign(size, -1);
+        for(int idx : unique){
+            uint32_t slot = hash(keys[idx], s) & (size - 1);
+            if(table[slot] >= 0)return false;
+            table[slot] = idx;
+        }
+        mask = size - 1;
+        seed = s;
+        return true;
+    }
+};
+
+#endif
@@ -0,0 +1,349 @@
+/*
+ * Parallel importer for historical access logs (seeding a fresh database)
+ * Every file is mmap'd and cut into chunks at line boundaries, the chunks
+ * are parsed on a pool of threads (parse_batch, one parser per thread)
+ * and the records of each chunk are sorted by timestamp.
+ *
+ * The sink is called from the calling thread in timestamp order: the
+ * files are merged with a k-way merge (min-heap over the head of every
+ * file), so the policy (LRU/LFUDA) sees the accesses as they happened,
+ * e.g. the logs of several nginx instances can be imported together.
+ * Each file must be in time order itself (nginx appends), only the
+ * records inside one chunk are reordered.
+ *
+ * Memory is bounded: a thread only parses a chunk of a file if it is
+ * less than IMPORT_WINDOW chunks ahead of what the merge has consumed
+ * from that file.
+ */
+
+#ifndef LOG_IMPORTER_H
+#define LOG_IMPORTER_H
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <queue>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "parser_simd.h"
+
+#define IMPORT_THREADS 8
+#define IMPORT_CHUNK   16777216 //16M
+#define IMPORT_WINDOW  4        //parsed chunks per file waiting for the merge
+
+template<typename P = FastParser>
+class LogImporter{
+public:
+    using LogValue = Parser::LogValue;
+    using Sink = std::function<void(std::vector<LogValue>& values)>;
+    //called in timestamp order from the thread calling run()
+
+    struct Report{
+        size_t lines, broken, chunks, bytes;
+        double seconds, lines_per_sec;
+    };
+
+    LogImporter(const std::vector<std::string>& keys, const std::string& time_key,
+                size_t threads = IMPORT_THREADS, size_t chunk_size = IMPORT_CHUNK) :
+                keys(keys), threads(threads), chunk_size(chunk_size){
+        auto it = std::find(keys.begin(), keys.end(), time_key);
+        if(it == keys.end() || threads == 0 || chunk_size == 0){
+            throw std::runtime_error("importer: invalid args");
+        }
+        time_index = it - keys.begin();
+    }
+
+    Report run(const std::vector<std::string>& paths, Sink sink){
+        auto start = std::chrono::steady_clock::now();
+        files.clear();
+        files.resize(paths.size());
+        Report report = {};
+        try{
+            for(size_t i = 0; i < paths.size(); i++){
+                map_file(paths[i], files[i]);
+                report.chunks += files[i].bounds.size() - 1;
+                report.bytes += files[i].size;
+            }
+        }catch(...){
+            unmap_all();
+            throw;
+        }
+        stop = false;
+        broken = 0;
+
+        std::vector<std::thread> pool;
+        for(size_t i = 0; i < threads; i++)pool.emplace_back(&LogImporter::worker, this);
+        try{
+            report.lines = merge(sink);
+        }catch(...){
+            shutdown(pool);
+            throw;
+        }
+        shutdown(pool);
+
+        report.broken = broken;
+        report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        report.lines_per_sec = report.seconds > 0 ? report.lines / report.seconds : 0;
+        return report;
+    }
+
+    //milliseconds since epoch from $msec (number or string), $time_iso8601
+    //or $time_local, 0 if unknown
+    static uint64_t timestamp_ms(const LogValue& value){
+        if(auto *num = std::get_if<int64_t>(&value))return *num < 0 ? 0 : to_ms(*num);
+        if(auto *num = std::get_if<uint64_t>(&value))return to_ms(*num);
+        if(auto *num = std::get_if<double>(&value))return *num < 0 ? 0 : *num * 1000;
+        auto *str = std::get_if<std::string>(&value);
+        if(str == nullptr || str->size() < 10)return 0;
+
+        const char* s = str->data();
+        const char* end = s + str->size();
+        int64_t year, month, day, hour, min, sec, offset = 0;
+        auto num = [&](size_t pos, size_t len, int64_t& out){
+            return pos + len <= str->size() && std::from_chars(s + pos, s + pos + len, out).ptr == s + pos + len;
+        };
+        if(s[4] == '-' && num(0, 4, year) && num(5, 2, month) && num(8, 2, day) &&
+           num(11, 2, hour) && num(14, 2, min) && num(17, 2, sec)){
+            //2025-01-01T00:00:10+08:00, 2025-01-01T00:00:10.123Z
+            const char* tz = s + 19;
+            uint64_t frac = 0;
+            if(tz < end && *tz == '.'){
+                const char* digits = ++tz;
+                while(tz < end && *tz >= '0' && *tz <= '9')tz++;
+                std::from_chars(digits, digits + std::min<ptrdiff_t>(tz - digits, 3), frac);
+                for(ptrdiff_t i = tz - digits; i < 3; i++)frac *= 10;
+            }
+            int64_t tz_hour, tz_min;
+            if(tz + 6 <= end && (*tz == '+' || *tz == '-') && std::from_chars(tz + 1, tz + 3, tz_hour).ptr == tz + 3 &&
+               std::from_chars(tz + 4, tz + 6, tz_min).ptr == tz + 6){
+                offset = (*tz == '-' ? -1 : 1) * (tz_hour * 3600 + tz_min * 60);
+            }
+            return epoch(year, month, day, hour, min, sec, offset) * 1000 + frac;
+        }
+
+        static const char months[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+        const char* mon = str->size() >= 26 && s[2] == '/' ? std::strstr(months, std::string(s + 3, 3).c_str()) : nullptr;
+        if(mon && (mon - months) % 3 == 0 && num(0, 2, day) && num(7, 4, year) && num(12, 2, hour) && num(15, 2, min) && num(18, 2, sec)){
+            //01/Jan/2025:00:00:10 +0800
+            month = (mon - months) / 3 + 1;
+            int64_t tz_hour, tz_min;
+            if((s[21] == '+' || s[21] == '-') && num(22, 2, tz_hour) && num(24, 2, tz_min)){
+                offset = (s[21] == '-' ? -1 : 1) * (tz_hour * 3600 + tz_min * 60);
+            }
+            return epoch(year, month, day, hour, min, sec, offset) * 1000;
+        }
+
+        double sec_f;
+        auto res = std::from_chars(s, end, sec_f);
+        if(res.ec == std::errc() && res.ptr == end && sec_f >= 0)return sec_f * 1000; //quoted $msec
+        return 0;
+    }
+
+private:
+    struct Record{
+        uint64_t time;
+        std::vector<LogValue> values;
+    };
+
+    struct File{
+        int fd = -1;
+        char* data = nullptr;
+        size_t size = 0;
+        std::vector<size_t> bounds;                  //chunk i is [bounds[i], bounds[i + 1])
+        size_t next_task = 0, consumed = 0;          //guarded by lock
+        std::map<size_t, std::vector<Record>> ready; //parsed, waiting for the merge
+    };
+
+    const std::vector<std::string> keys;
+    const size_t threads, chunk_size;
+    size_t time_index;
+
+    std::vector<File> files;
+    std::mutex lock;
+    std::condition_variable task_cv, ready_cv;
+    bool stop;
+    std::atomic<size_t> broken;
+
+    static uint64_t to_ms(uint64_t num){
+        return num > 100000000000ull ? num : num * 1000; //$msec in s or ms
+    }
+
+    static int64_t epoch(int64_t y, int64_t m, int64_t d, int64_t hh, int64_t mm, int64_t ss, int64_t offset){
+        y -= m <= 2;
+        int64_t era = (y >= 0 ? y : y - 399) / 400;
+        int64_t yoe = y - era * 400;
+        int64_t doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+        int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+        int64_t days = era * 146097 + doe - 719468; //days from civil (H. Hinnant)
+        int64_t result = days * 86400 + hh * 3600 + mm * 60 + ss - offset;
+        return result < 0 ? 0 : result;
+    }
+
+    void map_file(const std::string& path, File& file){
+        file.fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if(file.fd < 0)throw std::runtime_error("importer: fail to open " + path + ": " + std::strerror(errno));
+        struct stat st;
+        if(fstat(file.fd, &st))throw std::runtime_error("importer: fail to stat " + path);
+        file.size = st.st_size;
+        file.bounds = {0};
+        if(file.size == 0)return;
+
+        void* addr = mmap(nullptr, file.size, PROT_READ, MAP_PRIVATE, file.fd, 0);
+        if(addr == MAP_FAILED)throw std::runtime_error("importer: fail to mmap " + path + ": " + std::strerror(errno));
+        file.data = static_cast<char*>(addr);
+        madvise(addr, file.size, MADV_SEQUENTIAL);
+
+        size_t pos = 0;
+        while(pos < file.size){
+            size_t cut = std::min(pos + chunk_size, file.size);
+            if(cut < file.size){
+                auto *newline = static_cast<char*>(std::memchr(file.data + cut, '\n', file.size - cut));
+                cut = newline ? newline - file.data + 1 : file.size;
+            }
+            file.bounds.push_back(cut);
+            pos = cut;
+        }
+    }
+
+    void unmap_all(){
+        for(auto& it : files){
+            if(it.data)munmap(it.data, it.size);
+            if(it.fd >= 0)close(it.fd);
+            it.data = nullptr;
+            it.fd = -1;
+        }
+    }
+
+    void shutdown(std::vector<std::thread>& pool){
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            stop = true;
+        }
+        task_cv.notify_all();
+        for(auto& it : pool)it.join();
+        unmap_all();
+    }
+
+    //the file furthest behind with a chunk inside its window, -1 if none
+    int next_file(){
+        int best = -1;
+        size_t best_ahead = IMPORT_WINDOW;
+        for(size_t i = 0; i < files.size(); i++){
+            File& f = files[i];
+            if(f.next_task + 1 >= f.bounds.size())continue;
+            size_t ahead = f.next_task - f.consumed;
+            if(ahead < best_ahead){
+                best = i;
+                best_ahead = ahead;
+            }
+        }
+        return best;
+    }
+
+    void worker(){
+        P parser(keys);
+        std::vector<std::string_view> lines;
+        std::vector<std::vector<LogValue>> values;
+        while(true){
+            std::unique_lock<std::mutex> guard(lock);
+            int f;
+            task_cv.wait(guard, [&]{return stop || (f = next_file()) >= 0;});
+            if(stop)return;
+            size_t index = files[f].next_task++;
+            const char* begin = files[f].data + files[f].bounds[index];
+            const char* end = files[f].data + files[f].bounds[index + 1];
+            guard.unlock();
+
+            lines.clear();
+            while(begin < end){
+                auto *newline = static_cast<const char*>(std::memchr(begin, '\n', end - begin));
+                const char* line_end = newline ? newline : end;
+                if(line_end > begin)lines.emplace_back(begin, line_end - begin);
+                begin = line_end + 1;
+            }
+            broken += parser.parse_batch(lines, values);
+
+            std::vector<Record> records;
+            records.reserve(values.size());
+            uint64_t last = 0;
+            for(auto& it : values){
+                if(it.empty())continue;
+                uint64_t time = timestamp_ms(it[time_index]);
+                if(time == 0)time = last; //keep it next to its neighbour
+                last = time;
+                records.push_back({time, std::move(it)});
+            }
+            std::stable_sort(records.begin(), records.end(),
+                             [](const Record& a, const Record& b){return a.time < b.time;});
+
+            guard.lock();
+            files[f].ready.emplace(index, std::move(records));
+            guard.unlock();
+            ready_cv.notify_all();
+        }
+    }
+
+    //wait for the next chunk of file f, false if the file is finished
+    bool take(size_t f, std::vector<Record>& chunk){
+        std::unique_lock<std::mutex> guard(lock);
+        File& file = files[f];
+        if(file.consumed + 1 >= file.bounds.size())return false;
+        ready_cv.wait(guard, [&]{return file.ready.count(file.consumed);});
+        auto node = file.ready.extract(file.consumed);
+        chunk = std::move(node.mapped());
+        file.consumed++;
+        guard.unlock();
+        task_cv.notify_all(); //the window moved
+        return true;
+    }
+
+    size_t merge(Sink& sink){
+        struct Head{
+            uint64_t time;
+            size_t file;
+            bool operator>(const Head& other) const{
+                return time != other.time ? time > other.time : file > other.file;
+            }
+        };
+        std::vector<std::vector<Record>> chunks(files.size());
+        std::vector<size_t> pos(files.size(), 0);
+        std::priority_queue<Head, std::vector<Head>, std::greater<Head>> heap;
+
+        auto refill = [&](size_t f){ //next record of file f into the heap
+            while(pos[f] >= chunks[f].size()){
+                pos[f] = 0;
+                if(!take(f, chunks[f]))return;
+            }
+            heap.push({chunks[f][pos[f]].time, f});
+        };
+        for(size_t i = 0; i < files.size(); i++)refill(i);
+
+        size_t lines = 0;
+        while(!heap.empty()){
+            size_t f = heap.top().file;
+            heap.pop();
+            sink(chunks[f][pos[f]].values);
+            pos[f]++;
+            lines++;
+            refill(f);
+        }
+        return lines;
+    }
+};
+
+#endif
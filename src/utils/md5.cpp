@@ -0,0 +1,241 @@
+#include "md5.h"
+
+namespace{
+
+constexpr uint32_t md5_k[64] = {
+    0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+    0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+    0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+    0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+    0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+    0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+    0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+    0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391
+};
+constexpr int md5_s[64] = {
+    7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+    5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20,
+    4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+    6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21
+};
+constexpr uint32_t md5_init[4] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476};
+
+constexpr int md5_g(int i){
+    switch(i / 16){
+        case 0: return i;
+        case 1: return (5 * i + 1) % 16;
+        case 2: return (3 * i + 5) % 16;
+        default: return (7 * i) % 16;
+    }
+}
+
+//one lane type per width, with the operators used by the rounds
+struct Scalar{
+    uint32_t v;
+    static constexpr size_t lanes = 1;
+    static Scalar set1(uint32_t x){return {x};}
+    static Scalar gather(const uint32_t* const* w, int i){return {w[0][i]};}
+    void store(uint32_t* out) const{out[0] = v;}
+    template<int S> Scalar rotl() const{return {(v << S) | (v >> (32 - S))};}
+    Scalar operator+(Scalar o) const{return {v + o.v};}
+    Scalar operator&(Scalar o) const{return {v & o.v};}
+    Scalar operator|(Scalar o) const{return {v | o.v};}
+    Scalar operator^(Scalar o) const{return {v ^ o.v};}
+    Scalar operator~() const{return {~v};}
+    static Scalar andnot(Scalar a, Scalar b){return {~a.v & b.v};}    //~a & b
+};
+
+#if defined(__SSE2__)
+struct Sse2{
+    __m128i v;
+    static constexpr size_t lanes = 4;
+    static Sse2 set1(uint32_t x){return {_mm_set1_epi32(x)};}
+    static Sse2 gather(const uint32_t* const* w, int i){
+        return {_mm_set_epi32(w[3][i], w[2][i], w[1][i], w[0][i])};
+    }
+    void store(uint32_t* out) const{_mm_storeu_si128((__m128i*)out, v);}
+    template<int S> Sse2 rotl() const{return {_mm_or_si128(_mm_slli_epi32(v, S), _mm_srli_epi32(v, 32 - S))};}
+    Sse2 operator+(Sse2 o) const{return {_mm_add_epi32(v, o.v)};}
+    Sse2 operator&(Sse2 o) const{return {_mm_and_si128(v, o.v)};}
+    Sse2 operator|(Sse2 o) const{return {_mm_or_si128(v, o.v)};}
+    Sse2 operator^(Sse2 o) const{return {_mm_xor_si128(v, o.v)};}
+    Sse2 operator~() const{return {_mm_xor_si128(v, _mm_set1_epi32(-1))};}
+    static Sse2 andnot(Sse2 a, Sse2 b){return {_mm_andnot_si128(a.v, b.v)};}
+};
+#endif
+
+#if defined(__AVX2__)
+struct Avx2{
+    __m256i v;
+    static constexpr size_t lanes = 8;
+    static Avx2 set1(uint32_t x){return {_mm256_set1_epi32(x)};}
+    static Avx2 gather(const uint32_t* const* w, int i){
+        return {_mm256_set_epi32(w[7][i], w[6][i], w[5][i], w[4][i], w[3][i], w[2][i], w[1][i], w[0][i])};
+    }
+    void store(uint32_t* out) const{_mm256_storeu_si256((__m256i*)out, v);}
+    template<int S> Avx2 rotl() const{return {_mm256_or_si256(_mm256_slli_epi32(v, S), _mm256_srli_epi32(v, 32 - S))};}
+    Avx2 operator+(Avx2 o) const{return {_mm256_add_epi32(v, o.v)};}
+    Avx2 operator&(Avx2 o) const{return {_mm256_and_si256(v, o.v)};}
+    Avx2 operator|(Avx2 o) const{return {_mm256_or_si256(v, o.v)};}
+    Avx2 operator^(Avx2 o) const{return {_mm256_xor_si256(v, o.v)};}
+    Avx2 operator~() const{return {_mm256_xor_si256(v, _mm256_set1_epi32(-1))};}
+    static Avx2 andnot(Avx2 a, Avx2 b){return {_mm256_andnot_si256(a.v, b.v)};}
+};
+#endif
+
+#if defined(__AVX2__)
+using Lane = Avx2;
+#elif defined(__SSE2__)
+using Lane = Sse2;
+#else
+using Lane = Scalar;
+#endif
+
+//the roles of the 4 state words rotate by one every step
+template<typename V, int I>
+inline void md5_step(V* st, const V* w){
+    V& a = st[(64 - I) % 4];
+    const V& b = st[(65 - I) % 4];
+    const V& c = st[(66 - I) % 4];
+    const V& d = st[(67 - I) % 4];
+    V f;
+    if constexpr(I < 16)f = (b & c) | V::andnot(b, d);
+    else if constexpr(I < 32)f = (d & b) | V::andnot(d, c);
+    else if constexpr(I < 48)f = b ^ c ^ d;
+    else f = c ^ (b | ~d);
+    a = b + (a + f + V::set1(md5_k[I]) + w[md5_g(I)]).template rotl<md5_s[I]>();
+}
+
+template<typename V, size_t... I>
+inline void md5_rounds(V* st, const V* w, std::index_sequence<I...>){
+    (md5_step<V, I>(st, w), ...);
+}
+
+template<typename V>
+void md5_block(V* state, const V* w){
+    V st[4] = {state[0], state[1], state[2], state[3]};
+    md5_rounds(st, w, std::make_index_sequence<64>());
+    for(int i = 0; i < 4; i++)state[i] = state[i] + st[i];
+}
+
+size_t md5_blocks(size_t len){
+    return (len + 8) / 64 + 1;
+}
+
+//message with its padding and length, blocks * 64 bytes (little-endian words)
+void md5_pad(std::string_view data, size_t blocks, uint32_t* out){
+    auto *bytes = reinterpret_cast<uint8_t*>(out);
+    std::memcpy(bytes, data.data(), data.size());
+    std::memset(bytes + data.size(), 0, blocks * 64 - data.size());
+    bytes[data.size()] = 0x80;
+    uint64_t bits = (uint64_t)data.size() * 8;
+    std::memcpy(bytes + blocks * 64 - 8, &bits, 8);
+}
+
+template<typename V>
+void md5_lanes_run(const std::string_view* data, size_t blocks, Md5Digest** out,
+                   std::vector<uint32_t>& scratch){
+    scratch.resize(V::lanes * blocks * 16);
+    const uint32_t* words[V::lanes];
+    for(size_t l = 0; l < V::lanes; l++){
+        md5_pad(data[l], blocks, scratch.data() + l * blocks * 16);
+        words[l] = scratch.data() + l * blocks * 16;
+    }
+    V state[4] = {V::set1(md5_init[0]), V::set1(md5_init[1]), V::set1(md5_init[2]), V::set1(md5_init[3])};
+    V w[16];
+    for(size_t b = 0; b < blocks; b++){
+        for(int i = 0; i < 16; i++)w[i] = V::gather(words, b * 16 + i);
+        md5_block(state, w);
+    }
+    uint32_t res[4][V::lanes];
+    for(int i = 0; i < 4; i++)state[i].store(res[i]);
+    for(size_t l = 0; l < V::lanes; l++){
+        if(out[l] == nullptr)continue;
+        for(int i = 0; i < 4; i++)std::memcpy(out[l]->data() + i * 4, &res[i][l], 4);
+    }
+}
+
+}
+
+Md5Digest md5(std::string_view data){
+    Scalar state[4] = {{md5_init[0]}, {md5_init[1]}, {md5_init[2]}, {md5_init[3]}};
+    Scalar w[16];
+    size_t full = data.size() / 64;
+    for(size_t b = 0; b < full; b++){
+        std::memcpy(w, data.data() + b * 64, 64);
+        md5_block(state, w);
+    }
+    uint32_t tail[32];                         //the rest, padding and length (1 or 2 blocks)
+    std::string_view rest = data.substr(full * 64);
+    size_t blocks = md5_blocks(rest.size());
+    md5_pad(rest, blocks, tail);
+    uint64_t bits = (uint64_t)data.size() * 8;
+    std::memcpy(reinterpret_cast<uint8_t*>(tail) + blocks * 64 - 8, &bits, 8);
+    for(size_t b = 0; b < blocks; b++){
+        std::memcpy(w, tail + b * 16, 64);
+        md5_block(state, w);
+    }
+    Md5Digest digest;
+    for(int i = 0; i < 4; i++)std::memcpy(digest.data() + i * 4, &state[i].v, 4);
+    return digest;
+}
+
+void md5_batch(std::span<const std::string_view> data, std::vector<Md5Digest>& out){
+    out.resize(data.size());
+    if(Lane::lanes == 1 || data.size() == 1){
+        for(size_t i = 0; i < data.size(); i++)out[i] = md5(data[i]);
+        return;
+    }
+
+    std::vector<std::pair<size_t, size_t>> order; //(blocks, index)
+    order.reserve(data.size());
+    for(size_t i = 0; i < data.size(); i++)order.emplace_back(md5_blocks(data[i].size()), i);
+    std::sort(order.begin(), order.end());
+
+    std::string_view group[Lane::lanes];
+    Md5Digest* group_out[Lane::lanes];
+    std::vector<uint32_t> scratch;
+    for(size_t pos = 0; pos < order.size();){
+        size_t blocks = order[pos].first, n = 0;
+        while(n < Lane::lanes && pos < order.size() && order[pos].first == blocks){
+            group[n] = data[order[pos].second];
+            group_out[n] = &out[order[pos].second];
+            n++;
+            pos++;
+        }
+        for(size_t l = n; l < Lane::lanes; l++){ //idle lanes hash a copy, not stored
+            group[l] = group[0];
+            group_out[l] = nullptr;
+        }
+        md5_lanes_run<Lane>(group, blocks, group_out, scratch);
+    }
+}
+
+std::string md5_hex(const Md5Digest& digest){
+    static const char hex[] = "0123456789abcdef";
+    std::string res(32, '0');
+    for(size_t i = 0; i < 16; i++){
+        res[i * 2] = hex[digest[i] >> 4];
+        res[i * 2 + 1] = hex[digest[i] & 0xf];
+    }
+    return res;
+}
+
+bool md5_parse(std::string_view hex, Md5Digest& digest){
+    if(hex.size() != 32)return false;
+    auto nibble = [](char c) -> int{
+        if(c >= '0' && c <= '9')return c - '0';
+        if(c >= 'a' && c <= 'f')return c - 'a' + 10;
+        return -1;                         //nginx only writes lowercase
+    };
+    for(size_t i = 0; i < 16; i++){
+        int hi = nibble(hex[i * 2]), lo = nibble(hex[i * 2 + 1]);
+        if(hi < 0 || lo < 0)return false;
+        digest[i] = hi << 4 | lo;
+    }
+    return true;
+}
+
+size_t md5_lanes(){
+    return Lane::lanes;
+}
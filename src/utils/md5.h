@@ -0,0 +1,34 @@
+/*
+ * MD5, as used by nginx to name its cache files (md5 of proxy_cache_key)
+ * md5_batch() hashes several keys at once, one key per 32-bit lane:
+ * 8 lanes with AVX2, 4 with SSE2, scalar otherwise. The keys are grouped
+ * by their number of 64-byte blocks so the lanes of a group run in step
+ * (cache keys are mostly one or two blocks long).
+ */
+
+#ifndef MD5_H
+#define MD5_H
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+using Md5Digest = std::array<uint8_t, 16>;
+
+Md5Digest md5(std::string_view data);
+void md5_batch(std::span<const std::string_view> data, std::vector<Md5Digest>& out);
+std::string md5_hex(const Md5Digest& digest); //lowercase, as in the cache file name
+bool md5_parse(std::string_view hex, Md5Digest& digest); //32 hex characters, else false
+size_t md5_lanes();                            //keys hashed at once by md5_batch
+
+#endif
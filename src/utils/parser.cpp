@@ -4,24 +4,46 @@ Parser::Parser(const std::vector<std::string>& keys) : json_keys(keys){
     if(json_keys.empty())throw std::runtime_error("parser: invalid args");
 }
 
-std::vector<Parser::LogValue> Parser::parse(std::string data_raw){
+std::vector<Parser::LogValue> Parser::parse(std::string_view data_raw){
+    std::vector<LogValue> values;
+    parse(data_raw, values);
+    return values;
+}
+
+size_t Parser::parse_batch(std::span<const std::string_view> lines, std::vector<std::vector<LogValue>>& values){
+    size_t broken = 0;
+    values.resize(lines.size());
+    for(size_t i = 0; i < lines.size(); i++){
+        try{
+            parse(lines[i], values[i]);
+        }catch(const std::runtime_error& e){
+            values[i].clear();
+            broken++;
+        }
+    }
+    return broken;
+}
+
+void Parser::parse(std::string_view data_raw, std::vector<LogValue>& values){
     size_t ptr = data_raw.find('{');
-    if(ptr == data_raw.size())throw std::runtime_error("parser: invalid json");
-    data_raw = data_raw.substr(ptr);
+    if(ptr == std::string_view::npos)throw std::runtime_error("parser: invalid json");
+    data_raw.remove_prefix(ptr);
     
     json json_parsed;
     
     try{
-        json_parsed = json::parse(data_raw);
+        json_parsed = json::parse(data_raw.begin(), data_raw.end());
     }catch(json::parse_error& e){
         throw std::runtime_error(std::string("parser: fail to parse json: ") + e.what());
     }
 
-    std::vector<LogValue> values;
+    values.clear();
+    values.reserve(json_keys.size());
 
     for(auto& keys:json_keys){
-        if(json_parsed.contains(keys)){
-            const auto& val = json_parsed[keys];
+        auto it = json_parsed.find(keys);
+        if(it != json_parsed.end()){
+            const auto& val = *it;
             if(val.is_null()){
                 values.emplace_back(nullptr);
             }else if(val.is_boolean()){
@@ -41,7 +63,4 @@ std::vector<Parser::LogValue> Parser::parse(std::string data_raw){
             values.emplace_back((UnknownType){0, ""});
         }
     }
-
-    return values;
 }
-
@@ -1,8 +1,13 @@
+#ifndef PARSER_H
+#define PARSER_H
+
 #include <cstddef>
 #include <cstdint>
 #include <stdexcept>
 #include <iostream>
 #include <string>
+#include <span>
+#include <string_view>
 #include <variant>
 #include <vector>
 #include <nlohmann/json.hpp>
@@ -14,10 +19,16 @@ public:
     //TODO: remove int64_t (since nginx only provide unsigned int. To use the proper type, it must be removed)
     // the last is for unknown type
     Parser(const std::vector<std::string>& keys);
-    std::vector<LogValue> parse(std::string data_raw);
+    std::vector<LogValue> parse(std::string_view data_raw);
+    void parse(std::string_view data_raw, std::vector<LogValue>& values);
+    //reuse the caller's vector, data_raw is not copied
+    size_t parse_batch(std::span<const std::string_view> lines, std::vector<std::vector<LogValue>>& values);
+    //values[i] is empty if lines[i] is broken, return the number of broken lines
 
 private:
     using json = nlohmann::json;
     const std::vector<std::string> json_keys;
     
 };
+
+#endif
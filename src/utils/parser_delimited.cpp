@@ -0,0 +1,149 @@
+#include "parser_delimited.h"
+
+DelimitedParser::DelimitedParser(const std::vector<std::string>& keys, char delimiter) :
+                                 json_keys(keys), delimiter(delimiter){
+    if(json_keys.empty())throw std::runtime_error("parser: invalid args");
+    if(delimiter == '\n' || delimiter == '\\')throw std::runtime_error("parser: invalid delimiter");
+}
+
+/*
+ * Split data into at most max_fields fields, the last field takes the
+ * rest of the line. Return the number of fields found.
+ */
+size_t DelimitedParser::split(const char* data, size_t len, char delimiter,
+                              std::string_view* fields, size_t max_fields){
+    size_t count = 0, start = 0, pos = 0;
+    auto found = [&](size_t at){
+        fields[count++] = std::string_view(data + start, at - start);
+        start = at + 1;
+    };
+
+#if defined(__AVX2__)
+    const __m256i pattern = _mm256_set1_epi8(delimiter);
+    for(; pos + 32 <= len && count + 1 < max_fields; pos += 32){
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos));
+        uint32_t mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, pattern));
+        while(mask && count + 1 < max_fields){
+            found(pos + __builtin_ctz(mask));
+            mask &= mask - 1;
+        }
+    }
+#elif defined(__SSE2__)
+    const __m128i pattern = _mm_set1_epi8(delimiter);
+    for(; pos + 16 <= len && count + 1 < max_fields; pos += 16){
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+        uint32_t mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, pattern));
+        while(mask && count + 1 < max_fields){
+            found(pos + __builtin_ctz(mask));
+            mask &= mask - 1;
+        }
+    }
+#endif
+    pos = std::max(pos, start);
+    while(count + 1 < max_fields){
+        auto *next = static_cast<const char*>(std::memchr(data + pos, delimiter, len - pos));
+        if(next == nullptr)break;
+        found(next - data);
+        pos = start;
+    }//the tail shorter than one vector, or no SIMD
+
+    fields[count++] = std::string_view(data + start, len - start);
+    return count;
+}
+
+void DelimitedParser::unescape(std::string_view raw, std::string& out){
+    out.clear();
+    out.reserve(raw.size());
+    for(size_t i = 0; i < raw.size(); i++){
+        if(raw[i] == '\\' && i + 3 < raw.size() && raw[i + 1] == 'x'){
+            uint8_t byte;
+            auto res = std::from_chars(raw.data() + i + 2, raw.data() + i + 4, byte, 16);
+            if(res.ec == std::errc() && res.ptr == raw.data() + i + 4){
+                out.push_back(byte);
+                i += 3;
+                continue;
+            }
+        }
+        out.push_back(raw[i]);
+    }
+}
+
+void DelimitedParser::convert(std::string_view field, LogValue& value){
+    if(field == "-"){
+        value = nullptr;
+        return;
+    }
+
+    const char* begin = field.data();
+    const char* end = begin + field.size();
+    if(!field.empty() && ((*begin >= '0' && *begin <= '9') || *begin == '-')){
+        if(*begin == '-'){
+            int64_t num;
+            auto res = std::from_chars(begin, end, num);
+            if(res.ec == std::errc() && res.ptr == end){
+                value = num;
+                return;
+            }
+        }else{
+            uint64_t num;
+            auto res = std::from_chars(begin, end, num);
+            if(res.ec == std::errc() && res.ptr == end){
+                if(num <= static_cast<uint64_t>(std::numeric_limits<int64_t>::max()))value = static_cast<int64_t>(num);
+                else value = num;
+                return;
+            }
+        }
+        double num;
+        auto res = std::from_chars(begin, end, num, std::chars_format::fixed);
+        if(res.ec == std::errc() && res.ptr == end){
+            value = num;
+            return;
+        }
+    }//e.g. $request_time, $upstream_response_time
+
+    if(std::memchr(begin, '\\', field.size()) == nullptr){
+        value.emplace<std::string>(field);
+    }else{
+        std::string str;
+        unescape(field, str);
+        value = std::move(str);
+    }
+}
+
+void DelimitedParser::parse_views(std::string_view data_raw, std::vector<std::string_view>& fields){
+    while(!data_raw.empty() && (data_raw.back() == '\n' || data_raw.back() == '\r'))data_raw.remove_suffix(1);
+    fields.resize(json_keys.size() + 1); //the extra fields end up in the last one
+    size_t count = split(data_raw.data(), data_raw.size(), delimiter, fields.data(), fields.size());
+    for(size_t i = count; i < fields.size(); i++)fields[i] = std::string_view();
+    fields.pop_back();
+}
+
+size_t DelimitedParser::parse_batch(std::span<const std::string_view> lines, std::vector<std::vector<LogValue>>& values){
+    size_t broken = 0;
+    values.resize(lines.size());
+    for(size_t i = 0; i < lines.size(); i++){
+        try{
+            parse(lines[i], values[i]);
+        }catch(const std::runtime_error& e){
+            values[i].clear();
+            broken++;
+        }
+    }
+    return broken;
+}
+
+std::vector<DelimitedParser::LogValue> DelimitedParser::parse(std::string_view data_raw){
+    std::vector<LogValue> values;
+    parse(data_raw, values);
+    return values;
+}
+
+void DelimitedParser::parse(std::string_view data_raw, std::vector<LogValue>& values){
+    parse_views(data_raw, scratch);
+    values.clear();
+    values.reserve(json_keys.size());
+    for(auto& it : scratch){
+        if(it.data() == nullptr)values.emplace_back(UnknownType{0, ""});
+        else convert(it, values.emplace_back());
+    }
+}
@@ -0,0 +1,59 @@
+/*
+ * Parser for a delimiter-separated nginx log_format (TSV or \x1f)
+ * e.g. log_format cache "$time_iso8601\x1f$remote_addr\x1f$request...";
+ * The fields are mapped to json_keys by position, so the keys must be
+ * configured in the order of the log_format.
+ *
+ * The delimiters are located 32 (AVX2) or 16 (SSE2) bytes at a time,
+ * numbers are converted with std::from_chars. The value of a field is
+ * inferred from its text, as there is no quoting:
+ *   "-" (nginx empty variable)  -> nullptr
+ *   [-]digits                   -> int64_t (uint64_t above INT64_MAX)
+ *   decimal number              -> double
+ *   other                       -> std::string (\xXX escapes decoded)
+ * A missing field is UnknownType{0, ""}, extra fields are ignored.
+ *
+ * parse_views() only splits the line and returns the raw fields as views
+ * (no allocation once the vector has grown), for callers which only need
+ * a few fields as text.
+ */
+
+#ifndef PARSER_DELIMITED_H
+#define PARSER_DELIMITED_H
+
+#include <charconv>
+#include <cstring>
+#include <limits>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "parser.h"
+
+#define DEFAULT_DELIMITER '\x1f'
+
+class DelimitedParser{
+public:
+    using UnknownType = Parser::UnknownType;
+    using LogValue = Parser::LogValue;
+
+    DelimitedParser(const std::vector<std::string>& keys, char delimiter = DEFAULT_DELIMITER);
+    std::vector<LogValue> parse(std::string_view data_raw);
+    void parse(std::string_view data_raw, std::vector<LogValue>& values);
+    size_t parse_batch(std::span<const std::string_view> lines, std::vector<std::vector<LogValue>>& values);
+    void parse_views(std::string_view data_raw, std::vector<std::string_view>& fields);
+    //fields.size() == number of keys, a missing field is an empty view with nullptr data
+
+private:
+    const std::vector<std::string> json_keys;
+    const char delimiter;
+    std::vector<std::string_view> scratch;
+
+    static size_t split(const char* data, size_t len, char delimiter,
+                        std::string_view* fields, size_t max_fields);
+    static void convert(std::string_view field, LogValue& value);
+    static void unescape(std::string_view raw, std::string& out);
+};
+
+#endif
@@ -0,0 +1,269 @@
+#include "parser_projection.h"
+
+ProjectionParser::ProjectionParser(const std::vector<std::string>& keys) : key_table(keys) {}
+
+void ProjectionParser::fail(const char* what, const char* ptr, const char* begin){
+    throw std::runtime_error(std::string("parser: fail to parse json: ") + what +
+                             " at " + std::to_string(ptr - begin));
+}
+
+const char* ProjectionParser::skip_ws(const char* ptr, const char* end){
+    while(ptr < end && (*ptr == ' ' || *ptr == '\t' || *ptr == '\n' || *ptr == '\r'))ptr++;
+    return ptr;
+}
+
+//ptr: the first char after the opening quote, return the closing quote
+const char* ProjectionParser::scan_string(const char* ptr, const char* end, bool& escaped){
+    const char* start = ptr;
+    while(true){
+        auto *quote = static_cast<const char*>(std::memchr(ptr, '"', end - ptr));
+        if(quote == nullptr)fail("unterminated string", ptr, start);
+        const char* back = quote;
+        while(back > start && back[-1] == '\\')back--;
+        if((quote - back) % 2 == 0){
+            escaped = std::memchr(start, '\\', quote - start) != nullptr;
+            return quote;
+        }
+        ptr = quote + 1; //escaped quote
+    }
+}
+
+const char* ProjectionParser::skip_value(const char* ptr, const char* end){
+    bool escaped;
+    if(*ptr == '"')return scan_string(ptr + 1, end, escaped) + 1;
+
+    if(*ptr == '{' || *ptr == '['){
+        const char* start = ptr;
+        int depth = 0;
+        for(; ptr < end; ptr++){
+            char c = *ptr;
+            if(c == '"')ptr = scan_string(ptr + 1, end, escaped);
+            else if(c == '{' || c == '[')depth++;
+            else if((c == '}' || c == ']') && --depth == 0)return ptr + 1;
+        }
+        fail("unterminated object/array", ptr, start);
+    }
+
+    const char* start = ptr;
+    while(ptr < end && *ptr != ',' && *ptr != '}' && *ptr != ']' &&
+          *ptr != ' ' && *ptr != '\t' && *ptr != '\n' && *ptr != '\r')ptr++;
+    if(ptr == start)fail("missing value", ptr, start);
+    return ptr;
+}
+
+static int hex_value(char c){
+    if(c >= '0' && c <= '9')return c - '0';
+    if(c >= 'a' && c <= 'f')return c - 'a' + 10;
+    if(c >= 'A' && c <= 'F')return c - 'A' + 10;
+    return -1;
+}
+
+static bool read_hex4(const char* ptr, const char* end, uint32_t& code){
+    if(end - ptr < 4)return false;
+    code = 0;
+    for(int i = 0; i < 4; i++){
+        int v = hex_value(ptr[i]);
+        if(v < 0)return false;
+        code = code << 4 | v;
+    }
+    return true;
+}
+
+void ProjectionParser::unescape(std::string_view raw, std::string& out){
+    out.clear();
+    out.reserve(raw.size());
+    const char* ptr = raw.data();
+    const char* end = ptr + raw.size();
+    while(ptr < end){
+        auto *slash = static_cast<const char*>(std::memchr(ptr, '\\', end - ptr));
+        if(slash == nullptr){
+            out.append(ptr, end);
+            return;
+        }
+        out.append(ptr, slash);
+        if(slash + 1 >= end)fail("invalid escape", slash, raw.data());
+        ptr = slash + 2;
+        switch(slash[1]){
+            case '"': out.push_back('"'); break;
+            case '\\': out.push_back('\\'); break;
+            case '/': out.push_back('/'); break;
+            case 'b': out.push_back('\b'); break;
+            case 'f': out.push_back('\f'); break;
+            case 'n': out.push_back('\n'); break;
+            case 'r': out.push_back('\r'); break;
+            case 't': out.push_back('\t'); break;
+            case 'u':{
+                uint32_t code, low;
+                if(!read_hex4(ptr, end, code))fail("invalid \\u escape", slash, raw.data());
+                ptr += 4;
+                if(code >= 0xD800 && code <= 0xDBFF){
+                    if(end - ptr < 6 || ptr[0] != '\\' || ptr[1] != 'u' || !read_hex4(ptr + 2, end, low) ||
+                       low < 0xDC00 || low > 0xDFFF)fail("invalid surrogate pair", slash, raw.data());
+                    code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                    ptr += 6;
+                }else if(code >= 0xDC00 && code <= 0xDFFF){
+                    fail("invalid surrogate pair", slash, raw.data());
+                }
+                if(code < 0x80){
+                    out.push_back(code);
+                }else if(code < 0x800){
+                    out.push_back(0xC0 | code >> 6);
+                    out.push_back(0x80 | (code & 0x3F));
+                }else if(code < 0x10000){
+                    out.push_back(0xE0 | code >> 12);
+                    out.push_back(0x80 | (code >> 6 & 0x3F));
+                    out.push_back(0x80 | (code & 0x3F));
+                }else{
+                    out.push_back(0xF0 | code >> 18);
+                    out.push_back(0x80 | (code >> 12 & 0x3F));
+                    out.push_back(0x80 | (code >> 6 & 0x3F));
+                    out.push_back(0x80 | (code & 0x3F));
+                }
+                break;
+            }
+            default: fail("invalid escape", slash, raw.data());
+        }
+    }
+}
+
+const char* ProjectionParser::parse_number(const char* ptr, const char* end, LogValue& value){
+    const char* start = ptr;
+    bool is_float = false;
+    for(; ptr < end; ptr++){
+        char c = *ptr;
+        if(c == '.' || c == 'e' || c == 'E')is_float = true;
+        else if((c < '0' || c > '9') && c != '-' && c != '+')break;
+    }
+    if(ptr == start)fail("invalid value", start, start);
+
+    if(!is_float){
+        std::from_chars_result res;
+        if(*start == '-'){
+            int64_t num;
+            res = std::from_chars(start, ptr, num);
+            if(res.ec == std::errc() && res.ptr == ptr){
+                value = num;
+                return ptr;
+            }
+        }else{
+            uint64_t num;
+            res = std::from_chars(start, ptr, num);
+            if(res.ec == std::errc() && res.ptr == ptr){
+                if(num <= static_cast<uint64_t>(std::numeric_limits<int64_t>::max()))value = static_cast<int64_t>(num);
+                else value = num;
+                return ptr;
+            }
+        }
+        if(res.ec != std::errc::result_out_of_range)fail("invalid number", start, start);
+    }//out of range: like nlohmann, fall back to double
+
+    double num;
+    auto res = std::from_chars(start, ptr, num);
+    if(res.ec != std::errc() || res.ptr != ptr)fail("invalid number", start, start);
+    value = num;
+    return ptr;
+}
+
+const char* ProjectionParser::parse_value(const char* ptr, const char* end, LogValue& value){
+    switch(*ptr){
+        case '"':{
+            bool escaped;
+            const char* quote = scan_string(ptr + 1, end, escaped);
+            std::string_view raw(ptr + 1, quote - ptr - 1);
+            if(escaped){
+                std::string str;
+                unescape(raw, str);
+                value = std::move(str);
+            }else{
+                value.emplace<std::string>(raw);
+            }
+            return quote + 1;
+        }
+        case 't':
+            if(end - ptr < 4 || std::memcmp(ptr, "true", 4))fail("invalid literal", ptr, ptr);
+            value = true;
+            return ptr + 4;
+        case 'f':
+            if(end - ptr < 5 || std::memcmp(ptr, "false", 5))fail("invalid literal", ptr, ptr);
+            value = false;
+            return ptr + 5;
+        case 'n':
+            if(end - ptr < 4 || std::memcmp(ptr, "null", 4))fail("invalid literal", ptr, ptr);
+            value = nullptr;
+            return ptr + 4;
+        case '{':
+        case '[':{
+            const char* next = skip_value(ptr, end);
+            value = UnknownType{1, std::string(ptr, next)};
+            return next;
+        }
+        default:
+            return parse_number(ptr, end, value);
+    }
+}
+
+size_t ProjectionParser::parse_batch(std::span<const std::string_view> lines, std::vector<std::vector<LogValue>>& values){
+    size_t broken = 0;
+    values.resize(lines.size());
+    for(size_t i = 0; i < lines.size(); i++){
+        try{
+            parse(lines[i], values[i]);
+        }catch(const std::runtime_error& e){
+            values[i].clear();
+            broken++;
+        }
+    }
+    return broken;
+}
+
+std::vector<ProjectionParser::LogValue> ProjectionParser::parse(std::string_view data_raw){
+    std::vector<LogValue> values;
+    parse(data_raw, values);
+    return values;
+}
+
+void ProjectionParser::parse(std::string_view data_raw, std::vector<LogValue>& values){
+    size_t pos = data_raw.find('{');
+    if(pos == std::string_view::npos)throw std::runtime_error("parser: invalid json");
+    const char* begin = data_raw.data();
+    const char* end = begin + data_raw.size();
+    const char* ptr = skip_ws(begin + pos + 1, end);
+
+    values.clear();
+    values.resize(key_table.size(), UnknownType{0, ""});
+
+    if(ptr < end && *ptr == '}'){
+        ptr++;
+    }else while(true){
+        if(ptr >= end || *ptr != '"')fail("expected key", ptr, begin);
+        bool escaped;
+        const char* quote = scan_string(ptr + 1, end, escaped);
+        std::string_view key(ptr + 1, quote - ptr - 1);
+        if(escaped){
+            unescape(key, unescaped);
+            key = unescaped;
+        }
+        int idx = key_table.lookup(key);
+
+        ptr = skip_ws(quote + 1, end);
+        if(ptr >= end || *ptr != ':')fail("expected ':'", ptr, begin);
+        ptr = skip_ws(ptr + 1, end);
+        if(ptr >= end)fail("missing value", ptr, begin);
+        ptr = idx >= 0 ? parse_value(ptr, end, values[idx]) : skip_value(ptr, end);
+        //a duplicate key overwrites the value, the last one wins (as nlohmann)
+
+        ptr = skip_ws(ptr, end);
+        if(ptr < end && *ptr == ','){
+            ptr = skip_ws(ptr + 1, end);
+            continue;
+        }
+        if(ptr < end && *ptr == '}'){
+            ptr++;
+            break;
+        }
+        fail("expected ',' or '}'", ptr, begin);
+    }
+
+    if(skip_ws(ptr, end) != end)fail("unexpected trailing characters", ptr, begin);
+    key_table.copy_aliases(values);
+}
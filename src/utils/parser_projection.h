@@ -0,0 +1,50 @@
+/*
+ * Key-projection JSON parser (drop-in for Parser)
+ * nginx writes one flat JSON object per line, we only need a few keys
+ * of it. Instead of building a DOM, the object is scanned once: every
+ * key is looked up in a perfect hash table (KeyTable) of json_keys, the
+ * values of other keys are skipped without decoding, and a string is
+ * only unescaped when it contains a backslash.
+ *
+ * Differences from Parser:
+ *  - the skipped values are not fully validated
+ *  - a nested object/array is returned as its raw text (not re-dumped)
+ *  - an integer above INT64_MAX is returned as uint64_t instead of
+ *    being wrapped around
+ */
+
+#ifndef PARSER_PROJECTION_H
+#define PARSER_PROJECTION_H
+
+#include <charconv>
+#include <cstring>
+#include <limits>
+
+#include "key_table.h"
+#include "parser.h"
+
+class ProjectionParser{
+public:
+    using UnknownType = Parser::UnknownType;
+    using LogValue = Parser::LogValue;
+
+    ProjectionParser(const std::vector<std::string>& keys);
+    std::vector<LogValue> parse(std::string_view data_raw);
+    void parse(std::string_view data_raw, std::vector<LogValue>& values);
+    size_t parse_batch(std::span<const std::string_view> lines, std::vector<std::vector<LogValue>>& values);
+    //same semantics as Parser::parse
+
+private:
+    const KeyTable key_table;
+    std::string unescaped;                  //scratch for escaped keys
+
+    static const char* skip_ws(const char* ptr, const char* end);
+    static const char* scan_string(const char* ptr, const char* end, bool& escaped);
+    static const char* skip_value(const char* ptr, const char* end);
+    static void unescape(std::string_view raw, std::string& out);
+    static const char* parse_number(const char* ptr, const char* end, LogValue& value);
+    static const char* parse_value(const char* ptr, const char* end, LogValue& value);
+    [[noreturn]] static void fail(const char* what, const char* ptr, const char* begin);
+};
+
+#endif
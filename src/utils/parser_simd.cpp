@@ -0,0 +1,147 @@
+#include "parser_simd.h"
+
+#ifdef USE_SIMDJSON
+
+using namespace simdjson;
+
+static void check(error_code err){
+    if(err)throw std::runtime_error(std::string("parser: fail to parse json: ") + error_message(err));
+}
+
+SimdParser::SimdParser(const std::vector<std::string>& keys) : key_table(keys) {}
+
+size_t SimdParser::parse_batch(std::span<const std::string_view> lines, std::vector<std::vector<LogValue>>& values){
+    size_t broken = 0;
+    values.resize(lines.size());
+    for(size_t i = 0; i < lines.size(); i++){
+        try{
+            parse(lines[i], values[i]);
+        }catch(const std::runtime_error& e){
+            values[i].clear();
+            broken++;
+        }
+    }
+    return broken;
+}
+
+std::vector<SimdParser::LogValue> SimdParser::parse(std::string_view data_raw){
+    std::vector<LogValue> values;
+    parse(data_raw, values);
+    return values;
+}
+
+const char* SimdParser::pad(std::string_view data){
+    if(padded_buffer.size() < data.size() + SIMDJSON_PADDING){
+        padded_buffer.resize(data.size() + SIMDJSON_PADDING);
+    }
+    std::memcpy(padded_buffer.data(), data.data(), data.size());
+    return padded_buffer.data();
+}
+
+void SimdParser::parse(std::string_view data_raw, std::vector<LogValue>& values){
+    size_t pos = data_raw.find('{');
+    if(pos == std::string_view::npos)throw std::runtime_error("parser: invalid json");
+    data_raw.remove_prefix(pos);
+    parse_padded(std::string_view(pad(data_raw), data_raw.size()), values);
+}
+
+void SimdParser::parse_padded(std::string_view data_raw, std::vector<LogValue>& values){
+    size_t pos = data_raw.find('{');
+    if(pos == std::string_view::npos)throw std::runtime_error("parser: invalid json");
+    data_raw.remove_prefix(pos);
+
+    ondemand::document doc;
+    check(parser.iterate(data_raw.data(), data_raw.size(), data_raw.size() + SIMDJSON_PADDING).get(doc));
+    ondemand::object obj;
+    check(doc.get_object().get(obj));
+    fill(obj, values);
+    if(!doc.at_end())throw std::runtime_error("parser: fail to parse json: unexpected trailing characters");
+}
+
+size_t SimdParser::parse_many(std::string_view lines, const DocCallBack& cb, bool padded){
+    const char* data = padded ? lines.data() : pad(lines);
+    ondemand::document_stream stream;
+    check(batch_parser.iterate_many(data, lines.size(), SIMD_BATCH_SIZE).get(stream));
+
+    size_t broken = 0;
+    for(auto it = stream.begin(); it != stream.end(); ++it){
+        try{
+            ondemand::document_reference doc;
+            ondemand::object obj;
+            check((*it).get(doc));
+            check(doc.get_object().get(obj));
+            fill(obj, batch_values);
+            cb(batch_values);
+        }catch(const std::runtime_error& e){
+            broken++;
+        }//a broken line is skipped, the stream goes on with the next document
+    }
+    if(stream.truncated_bytes())broken++; //incomplete last line
+    return broken;
+}
+
+void SimdParser::fill(ondemand::object obj, std::vector<LogValue>& values){
+    values.clear();
+    values.resize(key_table.size(), UnknownType{0, ""});
+    for(auto field : obj){
+        std::string_view key;
+        check(field.unescaped_key().get(key));
+        int idx = key_table.lookup(key);
+        if(idx < 0)continue; //skipped by the next iteration
+        convert(field.value(), values[idx]);
+    }//a duplicate key overwrites the value, the last one wins (as nlohmann)
+    key_table.copy_aliases(values);
+}
+
+void SimdParser::convert(ondemand::value val, LogValue& out){
+    ondemand::json_type type;
+    check(val.type().get(type));
+    switch(type){
+        case ondemand::json_type::string:{
+            std::string_view str;
+            check(val.get_string().get(str));
+            out.emplace<std::string>(str);
+            break;
+        }
+        case ondemand::json_type::number:{
+            ondemand::number_type num_type;
+            check(val.get_number_type().get(num_type));
+            if(num_type == ondemand::number_type::signed_integer){
+                int64_t num;
+                check(val.get_int64().get(num));
+                out = num;
+            }else if(num_type == ondemand::number_type::unsigned_integer){
+                uint64_t num;
+                check(val.get_uint64().get(num));
+                out = num;
+            }else if(num_type == ondemand::number_type::floating_point_number){
+                double num;
+                check(val.get_double().get(num));
+                out = num;
+            }else{
+                std::string_view raw = val.raw_json_token();
+                double num;
+                auto res = std::from_chars(raw.data(), raw.data() + raw.size(), num);
+                if(res.ec != std::errc())throw std::runtime_error("parser: fail to parse json: invalid number");
+                out = num;
+            }//big integer, like nlohmann fall back to double
+            break;
+        }
+        case ondemand::json_type::boolean:{
+            bool b;
+            check(val.get_bool().get(b));
+            out = b;
+            break;
+        }
+        case ondemand::json_type::null:
+            out = nullptr;
+            break;
+        default:{
+            std::string_view raw;
+            check(val.raw_json().get(raw));
+            out = UnknownType{1, std::string(raw)};
+        }//object or array
+    }
+}
+
+#endif
@@ -0,0 +1,66 @@
+/*
+ * simdjson on-demand backend behind the Parser interface
+ * Build with -DUSE_SIMDJSON (and link simdjson) to enable it, FastParser
+ * is then SimdParser, otherwise it falls back to ProjectionParser.
+ * On-demand picks its kernel at compile time, so also build with
+ * -march=native (or at least -mavx2 -mpclmul -mbmi) on x86.
+ *
+ * simdjson reads up to SIMDJSON_PADDING bytes past the end of the input.
+ * parse() copies the line into an internal padded buffer, parse_padded()
+ * parses in place when the caller guarantees the padding (e.g. the views
+ * from Receiver::init_batch, see RING_PADDING). parse_many() parses a
+ * whole chunk of newline-separated lines with iterate_many.
+ *
+ * Numbers keep the signed/unsigned distinction of LogValue as in
+ * ProjectionParser: int64_t when it fits, uint64_t above INT64_MAX,
+ * double for floats and bigger integers.
+ */
+
+#ifndef PARSER_SIMD_H
+#define PARSER_SIMD_H
+
+#include <functional>
+
+#include "parser_projection.h"
+
+#ifdef USE_SIMDJSON
+
+#include <simdjson.h>
+
+#define SIMD_BATCH_SIZE 1048576 //iterate_many window, must hold the longest line
+
+class SimdParser{
+public:
+    using UnknownType = Parser::UnknownType;
+    using LogValue = Parser::LogValue;
+    using DocCallBack = std::function<void(std::vector<LogValue>& values)>;
+
+    SimdParser(const std::vector<std::string>& keys);
+    std::vector<LogValue> parse(std::string_view data_raw);
+    void parse(std::string_view data_raw, std::vector<LogValue>& values);
+    size_t parse_batch(std::span<const std::string_view> lines, std::vector<std::vector<LogValue>>& values);
+    void parse_padded(std::string_view data_raw, std::vector<LogValue>& values);
+    //SIMDJSON_PADDING readable bytes must follow data_raw
+    size_t parse_many(std::string_view lines, const DocCallBack& cb, bool padded = false);
+    //call cb for every line, return the number of broken lines
+
+private:
+    const KeyTable key_table;
+    simdjson::ondemand::parser parser, batch_parser;
+    std::vector<char> padded_buffer;
+    std::vector<LogValue> batch_values;
+
+    const char* pad(std::string_view data);
+    void fill(simdjson::ondemand::object obj, std::vector<LogValue>& values);
+    static void convert(simdjson::ondemand::value val, LogValue& out);
+};
+
+using FastParser = SimdParser;
+
+#else
+
+using FastParser = ProjectionParser;
+
+#endif
+
+#endif
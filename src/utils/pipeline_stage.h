@@ -0,0 +1,185 @@
+/*
+ * One stage of the ingestion pipeline (receive -> parse -> policy)
+ * A stage owns a bounded RingQueue and a thread that pops the items and
+ * runs the handler, so a slow stage (e.g. a SQLite commit in the policy)
+ * no longer stalls the socket.
+ *
+ * When the queue is full, push() follows the overflow policy:
+ *   OVERFLOW_BLOCK       wait until there is space (backpressure upstream)
+ *   OVERFLOW_DROP_OLDEST drop the head of the queue and retry
+ *   OVERFLOW_DROP_NEWEST drop the item being pushed
+ *
+ * Counters (depth, drops, time spent per item) are kept for every stage,
+ * so we can see where the latency builds up.
+ */
+
+#ifndef PIPELINE_STAGE_H
+#define PIPELINE_STAGE_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include "ring_queue.h"
+
+#define STAGE_CAPACITY 8192
+#define STAGE_IDLE     1 //ms, consumer sleeps at most this long when idle
+
+template<typename T>
+class Stage{
+public:
+    using Handler = std::function<void(T& item)>;
+
+    enum {
+        OVERFLOW_BLOCK,
+        OVERFLOW_DROP_OLDEST,
+        OVERFLOW_DROP_NEWEST
+    };
+
+    struct Stats{
+        size_t depth, capacity;
+        uint64_t pushed, processed, dropped, failed;
+        uint64_t busy_ns, max_ns;    //time spent in handler
+        uint64_t blocked_ns;         //time producers waited (OVERFLOW_BLOCK)
+        double avg_us() const{return processed ? busy_ns / 1000.0 / processed : 0;}
+    };
+
+    Stage(const std::string& name, Handler handler,
+          size_t capacity = STAGE_CAPACITY, int overflow = OVERFLOW_BLOCK) :
+          name(name), handler(handler), queue(capacity), overflow(overflow),
+          stop_signal(false), idle(false), pushed(0), processed(0), dropped(0),
+          failed(0), busy_ns(0), max_ns(0), blocked_ns(0){
+        if(overflow < OVERFLOW_BLOCK || overflow > OVERFLOW_DROP_NEWEST){
+            throw std::runtime_error("stage: invalid overflow policy");
+        }
+    }
+
+    ~Stage(){stop();}
+
+    Stage(const Stage&) = delete;
+    Stage& operator=(const Stage&) = delete;
+
+    void run(){
+        if(worker_thread.joinable())throw std::runtime_error("stage: already running");
+        stop_signal = false;
+        worker_thread = std::thread(&Stage::worker, this);
+    }
+
+    void stop(){ //process the remaining items and quit
+        if(!worker_thread.joinable())return;
+        stop_signal = true;
+        wake();
+        worker_thread.join();
+    }
+
+    bool push(T&& item){ //false if the item is dropped
+        pushed.fetch_add(1, std::memory_order_relaxed);
+        if(queue.try_push(std::move(item))){
+            if(idle.load(std::memory_order_acquire))wake();
+            return true;
+        }
+
+        if(overflow == OVERFLOW_DROP_NEWEST){
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        if(overflow == OVERFLOW_DROP_OLDEST){
+            T oldest;
+            while(!queue.try_push(std::move(item))){
+                if(queue.try_pop(oldest))dropped.fetch_add(1, std::memory_order_relaxed);
+            }
+            if(idle.load(std::memory_order_acquire))wake();
+            return true;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        for(int spin = 0; !queue.try_push(std::move(item)); spin++){
+            wake();
+            if(spin < 64)std::this_thread::yield();
+            else std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+        blocked_ns.fetch_add(elapsed_ns(start), std::memory_order_relaxed);
+        return true;
+    }
+
+    Stats stats() const{
+        return {queue.size_approx(), queue.capacity(),
+                pushed.load(std::memory_order_relaxed),
+                processed.load(std::memory_order_relaxed),
+                dropped.load(std::memory_order_relaxed),
+                failed.load(std::memory_order_relaxed),
+                busy_ns.load(std::memory_order_relaxed),
+                max_ns.load(std::memory_order_relaxed),
+                blocked_ns.load(std::memory_order_relaxed)};
+    }
+
+    const std::string& stage_name() const{return name;}
+
+private:
+    const std::string name;
+    Handler handler;
+    RingQueue<T> queue;
+    const int overflow;
+
+    std::thread worker_thread;
+    std::mutex idle_lock;
+    std::condition_variable idle_cv;
+    std::atomic<bool> stop_signal, idle;
+    std::atomic<uint64_t> pushed, processed, dropped, failed;
+    std::atomic<uint64_t> busy_ns, max_ns, blocked_ns;
+
+    static uint64_t elapsed_ns(std::chrono::steady_clock::time_point start){
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now() - start).count();
+    }
+
+    void wake(){
+        std::lock_guard<std::mutex> lock(idle_lock);
+        idle_cv.notify_one();
+    }
+
+    void worker(){
+        T item;
+        while(true){
+            if(!queue.try_pop(item)){
+                if(stop_signal)return;
+                std::unique_lock<std::mutex> lock(idle_lock);
+                idle.store(true, std::memory_order_release);
+                if(queue.size_approx() == 0 && !stop_signal){
+                    idle_cv.wait_for(lock, std::chrono::milliseconds(STAGE_IDLE));
+                }//timed wait, a missed wakeup costs at most STAGE_IDLE
+                idle.store(false, std::memory_order_release);
+                continue;
+            }
+
+            auto start = std::chrono::steady_clock::now();
+            try{
+                handler(item);
+            }catch(const std::exception& e){
+                if(failed.fetch_add(1, std::memory_order_relaxed) % 1000 == 0){
+                    std::cerr << "stage " << name << ": handler failed: " << e.what() << std::endl;
+                }
+            }
+            uint64_t cost = elapsed_ns(start);
+            busy_ns.fetch_add(cost, std::memory_order_relaxed);
+            if(cost > max_ns.load(std::memory_order_relaxed)){
+                max_ns.store(cost, std::memory_order_relaxed); //single writer
+            }
+            processed.fetch_add(1, std::memory_order_relaxed);
+            item = T();
+        }
+    }
+};
+
+#endif
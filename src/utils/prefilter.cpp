@@ -0,0 +1,105 @@
+#include "prefilter.h"
+
+Prefilter::Prefilter(const Rules& rules) :
+                     rules(rules), status_needle(needle(rules.cache_status_key)),
+                     method_needle(needle(rules.method_key)), uri_needle(needle(rules.uri_key)),
+                     combined_request(rules.method_key == rules.uri_key){
+    if(rules.cache_status_key.empty() || rules.method_key.empty() || rules.uri_key.empty()){
+        throw std::runtime_error("prefilter: invalid args");
+    }
+    for(auto& it : counts)it.store(0);
+}
+
+std::string Prefilter::needle(const std::string& key){
+    return "\"" + key + "\":";
+}
+
+/*
+ * Locate "key": and return the string value (without quotes, still
+ * escaped). A key inside a string value would be preceded by '\', so
+ * "key": only matches a real key as long as the value contains no
+ * unescaped quote, which JSON doesn't allow.
+ */
+bool Prefilter::find_value(std::string_view raw, const std::string& needle, std::string_view& value){
+    auto *pos = static_cast<const char*>(memmem(raw.data(), raw.size(), needle.data(), needle.size()));
+    if(pos == nullptr)return false;
+    const char* end = raw.data() + raw.size();
+    const char* ptr = pos + needle.size();
+    while(ptr < end && *ptr == ' ')ptr++;
+    if(ptr >= end || *ptr != '"')return false;
+    ptr++;
+    auto *quote = static_cast<const char*>(std::memchr(ptr, '"', end - ptr));
+    if(quote == nullptr)return false;
+    value = std::string_view(ptr, quote - ptr);
+    return true;
+}
+
+bool Prefilter::match_any(std::string_view value, const std::vector<std::string>& list){
+    for(auto& it : list)if(value == it)return true;
+    return false;
+}
+
+bool Prefilter::prefix_any(std::string_view value, const std::vector<std::string>& list){
+    for(auto& it : list)if(value.substr(0, it.size()) == it)return true;
+    return false;
+}
+
+int Prefilter::count_and_return(int reason){
+    counts[reason].fetch_add(1, std::memory_order_relaxed);
+    return reason == FIELD_MISSING ? PASS : reason;
+}
+
+int Prefilter::check(std::string_view raw){
+    std::string_view value;
+    if(rules.cache_status.size()){
+        if(!find_value(raw, status_needle, value))return count_and_return(FIELD_MISSING);
+        if(!match_any(value, rules.cache_status))return count_and_return(DROP_CACHE_STATUS);
+    }
+
+    bool need_method = rules.methods.size();
+    bool need_uri = rules.uri_include.size() || rules.uri_exclude.size();
+    if(!need_method && !need_uri)return count_and_return(PASS);
+
+    std::string_view method, uri;
+    if(combined_request){
+        if(!find_value(raw, method_needle, value))return count_and_return(FIELD_MISSING);
+        size_t space = value.find(' ');
+        if(space == std::string_view::npos)return count_and_return(FIELD_MISSING);
+        method = value.substr(0, space);
+        uri = value.substr(space + 1); //the protocol is left, only prefixes are compared
+    }else{
+        if(need_method && !find_value(raw, method_needle, method))return count_and_return(FIELD_MISSING);
+        if(need_uri && !find_value(raw, uri_needle, uri))return count_and_return(FIELD_MISSING);
+    }
+
+    if(need_method && !match_any(method, rules.methods))return count_and_return(DROP_METHOD);
+    if(need_uri){
+        if(prefix_any(uri, rules.uri_exclude))return count_and_return(DROP_URI_EXCLUDED);
+        if(rules.uri_include.size() && !prefix_any(uri, rules.uri_include))return count_and_return(DROP_URI_NOT_INCLUDED);
+    }
+    return count_and_return(PASS);
+}
+
+uint64_t Prefilter::count(int reason) const{
+    if(reason < 0 || reason >= REASON_NUM)throw std::runtime_error("prefilter: invalid reason");
+    return counts[reason].load(std::memory_order_relaxed);
+}
+
+std::array<uint64_t, Prefilter::REASON_NUM> Prefilter::counters() const{
+    std::array<uint64_t, REASON_NUM> res;
+    for(int i = 0; i < REASON_NUM; i++)res[i] = counts[i].load(std::memory_order_relaxed);
+    return res;
+}
+
+const char* Prefilter::reason_name(int reason){
+    static const char* const names[] = {
+        "pass",
+        "cache_status",
+        "method",
+        "uri_excluded",
+        "uri_not_included",
+        "field_missing"
+    };
+    if(reason < 0 || reason >= REASON_NUM)return "unknown";
+    return names[reason];
+}
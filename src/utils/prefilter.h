@@ -0,0 +1,75 @@
+/*
+ * Byte-level filter on the raw log line, before it is parsed
+ * Most lines (/simple/ index pages, uncached locations) are of no use to
+ * the cache policy, they are dropped here without decoding the JSON:
+ * the fields are located with memmem on '"key":' and compared as bytes.
+ *
+ * Rules (an empty list accepts everything):
+ *   cache_status  accepted values of upstream_cache_status (HIT, MISS...)
+ *   methods       accepted request methods (GET, HEAD...)
+ *   uri_include   accepted URI prefixes (/packages/...)
+ *   uri_exclude   dropped URI prefixes (/simple/...), checked first
+ * method_key/uri_key may both be "request" ($request = "GET /uri HTTP/1.1")
+ * or point to $request_method/$request_uri.
+ *
+ * A line where a field can't be found is passed (the parser decides),
+ * and counted as missing. All counters are atomic, check() can be called
+ * from any thread.
+ */
+
+#ifndef PREFILTER_H
+#define PREFILTER_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class Prefilter{
+public:
+    struct Rules{
+        std::vector<std::string> cache_status;
+        std::vector<std::string> methods;
+        std::vector<std::string> uri_include;
+        std::vector<std::string> uri_exclude;
+        std::string cache_status_key = "upstream_cache_status";
+        std::string method_key = "request";
+        std::string uri_key = "request";
+    };
+
+    enum {
+        PASS,
+        DROP_CACHE_STATUS,
+        DROP_METHOD,
+        DROP_URI_EXCLUDED,
+        DROP_URI_NOT_INCLUDED,
+        FIELD_MISSING,        //passed, but a field was not found
+        REASON_NUM
+    };
+
+    Prefilter(const Rules& rules);
+    int check(std::string_view raw);        //PASS or DROP_*
+    bool pass(std::string_view raw){return check(raw) == PASS;}
+
+    uint64_t count(int reason) const;
+    std::array<uint64_t, REASON_NUM> counters() const;
+    static const char* reason_name(int reason);
+
+private:
+    const Rules rules;
+    const std::string status_needle, method_needle, uri_needle;
+    const bool combined_request;            //method and uri both from $request
+    std::array<std::atomic<uint64_t>, REASON_NUM> counts;
+
+    static std::string needle(const std::string& key);
+    static bool find_value(std::string_view raw, const std::string& needle, std::string_view& value);
+    static bool match_any(std::string_view value, const std::vector<std::string>& list);
+    static bool prefix_any(std::string_view value, const std::vector<std::string>& list);
+    int count_and_return(int reason);
+};
+
+#endif
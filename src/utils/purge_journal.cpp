@@ -0,0 +1,216 @@
+#include "purge_journal.h"
+
+#define JOURNAL_MAGIC 0x4a504358 //"XCPJ"
+
+/*
+ * record: epoch (4) | type (1) | 0 (1) | length (2) | path | checksum (4)
+ * the checksum covers everything before it
+ */
+#define REC_HEAD 8
+#define REC_TAIL 4
+
+PurgeJournal::PurgeJournal(const std::string& path, size_t cs) : file_path(path), compact_size(cs){
+    if(path.empty() || compact_size < JOURNAL_GROW)throw std::runtime_error("purge journal: invalid args");
+    struct stat st;
+    bool exist = stat(path.c_str(), &st) == 0 && static_cast<size_t>(st.st_size) >= sizeof(Header);
+    open_map(path, exist ? st.st_size : JOURNAL_GROW);
+
+    Header header;
+    std::memcpy(&header, map, sizeof(header));
+    if(!exist || header.magic != JOURNAL_MAGIC){
+        if(exist)std::cerr << "purge journal: bad header, starting a new one: " << path << std::endl;
+        epoch = 1;
+        write_header();
+    }else{
+        epoch = header.epoch;
+    }
+    offset = synced = sizeof(Header);
+}
+
+PurgeJournal::~PurgeJournal(){
+    try{
+        sync();
+    }catch(const std::exception& e){
+        std::cerr << "exception: " << e.what() << std::endl;
+    }
+    close_map();
+}
+
+uint32_t PurgeJournal::checksum(const char* data, size_t len){
+    uint32_t hash = 2166136261u;
+    for(size_t i = 0; i < len; i++){
+        hash ^= static_cast<uint8_t>(data[i]);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+void PurgeJournal::open_map(const std::string& path, size_t size){
+    fd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if(fd < 0)throw std::runtime_error("purge journal: open " + path + ": " + strerror(errno));
+    struct stat st;
+    if(fstat(fd, &st) || (static_cast<size_t>(st.st_size) < size && ftruncate(fd, size))){
+        int err = errno;
+        close(fd);
+        fd = -1;
+        throw std::runtime_error("purge journal: resize " + path + ": " + strerror(err));
+    }
+    capacity = std::max(size, static_cast<size_t>(st.st_size));
+    void* ptr = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if(ptr == MAP_FAILED){
+        int err = errno;
+        close(fd);
+        fd = -1;
+        throw std::runtime_error("purge journal: mmap " + path + ": " + strerror(err));
+    }
+    map = static_cast<char*>(ptr);
+}
+
+void PurgeJournal::close_map(){
+    if(map != nullptr)munmap(map, capacity);
+    if(fd >= 0)close(fd);
+    map = nullptr;
+    fd = -1;
+}
+
+void PurgeJournal::write_header(){
+    Header header = {JOURNAL_MAGIC, epoch};
+    std::memcpy(map, &header, sizeof(header));
+    if(msync(map, sizeof(header), MS_SYNC)){
+        throw std::runtime_error(std::string("purge journal: msync: ") + strerror(errno));
+    }
+}
+
+std::vector<std::string> PurgeJournal::replay(){
+    std::lock_guard<std::mutex> lock_gd(journal_lock);
+    live.clear();
+    live_bytes = 0;
+    size_t pos = sizeof(Header);
+    while(pos + REC_HEAD + REC_TAIL <= capacity){
+        uint32_t rec_epoch, sum;
+        uint16_t len;
+        std::memcpy(&rec_epoch, map + pos, 4);
+        std::memcpy(&len, map + pos + 6, 2);
+        if(rec_epoch != epoch || pos + REC_HEAD + len + REC_TAIL > capacity)break;
+        std::memcpy(&sum, map + pos + REC_HEAD + len, 4);
+        if(sum != checksum(map + pos, REC_HEAD + len))break; //torn write
+        std::string path(map + pos + REC_HEAD, len);
+        if(map[pos + 4] == REC_ADD){
+            if(live.insert(path).second)live_bytes += REC_HEAD + len + REC_TAIL;
+        }else if(live.erase(path)){
+            live_bytes -= REC_HEAD + len + REC_TAIL;
+        }
+        pos += REC_HEAD + len + REC_TAIL;
+    }
+    offset = synced = pos;
+    return std::vector<std::string>(live.begin(), live.end());
+}
+
+void PurgeJournal::reserve(size_t len){
+    if(offset + len <= capacity)return;
+    size_t new_capacity = std::max(capacity * 2, offset + len + JOURNAL_GROW);
+    if(ftruncate(fd, new_capacity)){
+        throw std::runtime_error(std::string("purge journal: grow: ") + strerror(errno));
+    }
+    void* ptr = mremap(map, capacity, new_capacity, MREMAP_MAYMOVE);
+    if(ptr == MAP_FAILED)throw std::runtime_error(std::string("purge journal: mremap: ") + strerror(errno));
+    map = static_cast<char*>(ptr);
+    capacity = new_capacity;
+}
+
+void PurgeJournal::append(int type, const std::string& path){
+    size_t len = REC_HEAD + path.size() + REC_TAIL;
+    reserve(len);
+    char* rec = map + offset;
+    uint16_t path_len = path.size();
+    std::memcpy(rec, &epoch, 4);
+    rec[4] = type;
+    rec[5] = 0;
+    std::memcpy(rec + 6, &path_len, 2);
+    std::memcpy(rec + REC_HEAD, path.data(), path.size());
+    uint32_t sum = checksum(rec, REC_HEAD + path.size());
+    std::memcpy(rec + REC_HEAD + path.size(), &sum, 4);
+    offset += len;
+}
+
+void PurgeJournal::add(const std::string& path){
+    std::lock_guard<std::mutex> lock_gd(journal_lock);
+    if(path.size() > UINT16_MAX){
+        std::cerr << "purge journal: path too long, not recorded" << std::endl;
+        return;
+    }
+    if(!live.insert(path).second)return;
+    live_bytes += REC_HEAD + path.size() + REC_TAIL;
+    append(REC_ADD, path);
+}
+
+void PurgeJournal::done(const std::string& path){
+    std::lock_guard<std::mutex> lock_gd(journal_lock);
+    if(!live.erase(path))return;
+    live_bytes -= REC_HEAD + path.size() + REC_TAIL;
+    append(REC_DONE, path);
+}
+
+void PurgeJournal::reset(){
+    epoch++;
+    write_header();
+    offset = synced = sizeof(Header);
+}
+
+void PurgeJournal::rewrite(){
+    std::string tmp_path = file_path + ".tmp";
+    unlink(tmp_path.c_str());
+    int old_fd = fd;
+    char* old_map = map;
+    size_t old_capacity = capacity;
+    try{
+        open_map(tmp_path, sizeof(Header) + live_bytes + JOURNAL_GROW);
+    }catch(const std::exception& e){
+        std::cerr << e.what() << std::endl;
+        fd = old_fd;
+        map = old_map;
+        capacity = old_capacity;
+        return;                            //keep appending to the old one
+    }
+    munmap(old_map, old_capacity);
+    close(old_fd);
+
+    epoch++;
+    offset = sizeof(Header);
+    for(auto& it : live)append(REC_ADD, it);
+    if(msync(map, offset, MS_SYNC)){
+        throw std::runtime_error(std::string("purge journal: msync: ") + strerror(errno));
+    }
+    write_header();
+    if(rename(tmp_path.c_str(), file_path.c_str())){
+        throw std::runtime_error("purge journal: rename " + tmp_path + ": " + strerror(errno));
+    }
+    synced = offset;
+}
+
+void PurgeJournal::sync(){
+    std::lock_guard<std::mutex> lock_gd(journal_lock);
+    if(live.empty() && offset > sizeof(Header)){
+        reset();                           //drained, nothing to keep
+        return;
+    }
+    if(offset > synced){
+        size_t page = sysconf(_SC_PAGESIZE);
+        size_t begin = synced / page * page;
+        if(msync(map + begin, offset - begin, MS_SYNC)){
+            throw std::runtime_error(std::string("purge journal: msync: ") + strerror(errno));
+        }
+        synced = offset;
+    }
+    if(offset > compact_size && live_bytes < compact_size / 2)rewrite();
+}
+
+size_t PurgeJournal::pending() const{
+    std::lock_guard<std::mutex> lock_gd(journal_lock);
+    return live.size();
+}
+
+size_t PurgeJournal::size() const{
+    std::lock_guard<std::mutex> lock_gd(journal_lock);
+    return offset;
+}
@@ -0,0 +1,83 @@
+/*
+ * Append-only journal of the pending purges
+ * A path is appended (ADD) when it enters the purge queue and marked
+ * (DONE) when it is purged or given up. On startup replay() returns the
+ * paths added but not done, so the files evicted from the database
+ * before a crash are still purged.
+ *
+ * The file is memory-mapped, appends are memcpy into the mapping and
+ * sync() msyncs what was written since the last one, so the cost of
+ * durability is paid once per batch. A crash may lose the records of
+ * the last interval, and a torn record ends the replay (checksum).
+ *
+ * Every record carries the epoch of the header. Once everything is done
+ * the epoch is increased and the journal is written from the start
+ * again, the old records no longer match and are ignored. If the file
+ * grows past compact_size with paths still pending, they are rewritten
+ * to a new file which replaces the old one (rename).
+ */
+
+#ifndef PURGE_JOURNAL_H
+#define PURGE_JOURNAL_H
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <algorithm>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define JOURNAL_GROW    1048576    //the file grows by at least 1M
+#define JOURNAL_COMPACT 67108864   //rewrite the pending paths past 64M
+
+class PurgeJournal{
+public:
+    PurgeJournal(const std::string& path, size_t compact_size = JOURNAL_COMPACT);
+    ~PurgeJournal();
+
+    std::vector<std::string> replay();         //pending paths, call once before use
+    void add(const std::string& path);
+    void done(const std::string& path);
+    void sync();                               //msync the new records, compact if drained
+
+    size_t pending() const;
+    size_t size() const;                       //bytes in use
+
+private:
+    enum {REC_ADD = 1, REC_DONE = 2};
+    struct Header{
+        uint32_t magic;
+        uint32_t epoch;
+    };
+
+    const std::string file_path;
+    const size_t compact_size;
+    mutable std::mutex journal_lock;
+    int fd = -1;
+    char* map = nullptr;
+    size_t capacity = 0, offset = 0, synced = 0;
+    size_t live_bytes = 0;                     //what a rewrite would take
+    uint32_t epoch = 0;
+    std::unordered_set<std::string> live;
+
+    static uint32_t checksum(const char* data, size_t len);
+    void open_map(const std::string& path, size_t size);
+    void close_map();
+    void reserve(size_t len);
+    void append(int type, const std::string& path);
+    void write_header();
+    void reset();                              //new epoch, from the start
+    void rewrite();                            //only the live paths, to a new file
+};
+
+#endif
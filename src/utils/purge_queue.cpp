@@ -0,0 +1,77 @@
+#include "purge_queue.h"
+
+PurgeQueue::PurgeQueue(size_t entries, size_t bytes, long base, long max, long tick, size_t slots) :
+                       max_entries(entries), max_bytes(bytes), retry_base(base), retry_max(max),
+                       tick_ms(tick), wheel(slots), epoch(Clock::now()){
+    if(!entries || !bytes || base <= 0 || max < base || tick <= 0 || !slots){
+        throw std::runtime_error("purge queue: invalid args");
+    }
+}
+
+uint64_t PurgeQueue::to_tick(Clock::time_point tp) const{
+    if(tp <= epoch)return 0;
+    return std::chrono::duration_cast<std::chrono::milliseconds>(tp - epoch).count() / tick_ms;
+}
+
+int PurgeQueue::push(const std::string& path){
+    return push(std::string(path));
+}
+
+int PurgeQueue::push(std::string&& path){
+    if(paths.count(path)){
+        collapsed_count++;
+        return COLLAPSED;
+    }
+    if(paths.size() >= max_entries || tracked_bytes + path.size() > max_bytes)return FULL;
+    tracked_bytes += path.size();
+    paths.insert(path);
+    ready_queue.emplace_back(std::move(path), 0);
+    return ADDED;
+}
+
+bool PurgeQueue::pop(std::string& path, int& tries){
+    if(ready_queue.empty())return false;
+    path = std::move(ready_queue.front().first);
+    tries = ready_queue.front().second;
+    ready_queue.pop_front();
+    return true;
+}
+
+void PurgeQueue::retry(const std::string& path, int tries, Clock::time_point now){
+    long delay = retry_base;
+    for(int i = 1; i < tries && delay < retry_max; i++)delay *= 2;
+    if(delay > retry_max)delay = retry_max;
+    uint64_t expire = std::max(to_tick(now + std::chrono::milliseconds(delay)), current + 1);
+    wheel[expire % wheel.size()].push_back({path, tries, expire});
+    scheduled_count++;
+}
+
+void PurgeQueue::done(const std::string& path){
+    if(paths.erase(path))tracked_bytes -= path.size();
+}
+
+void PurgeQueue::advance(Clock::time_point now){
+    uint64_t target = to_tick(now);
+    if(target <= current)return;
+    if(scheduled_count == 0){
+        current = target;
+        return;
+    }
+    //after a long stall every slot is visited once
+    uint64_t steps = std::min<uint64_t>(target - current, wheel.size());
+    for(uint64_t t = target - steps + 1; t <= target; t++){
+        auto& slot = wheel[t % wheel.size()];
+        size_t kept = 0;
+        for(auto& it : slot){
+            if(it.expire <= target){
+                ready_queue.emplace_back(std::move(it.path), it.tries);
+                scheduled_count--;
+            }else{
+                if(&slot[kept] != &it)slot[kept] = std::move(it); //a later round of the wheel
+                kept++;
+            }
+        }
+        slot.resize(kept);
+    }
+    current = target;
+}
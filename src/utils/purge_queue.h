@@ -0,0 +1,77 @@
+/*
+ * Queue of paths to purge, without duplicates
+ * A path is tracked from push() until done(): while it is queued, in
+ * flight or waiting for a retry, pushing it again is collapsed into the
+ * existing entry. The bound applies to the tracked paths (entries and
+ * bytes), so a retry never overflows.
+ *
+ * Retries wait on a hashed timer wheel (tick_ms per slot), the delay
+ * doubles on every try: retry_base, 2 * retry_base, ... up to retry_max.
+ * advance() moves the due ones back to the ready queue.
+ *
+ * Not thread-safe, the owner holds its lock.
+ */
+
+#ifndef PURGE_QUEUE_H
+#define PURGE_QUEUE_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <stdexcept>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#define PURGE_QUEUE_BYTES 16777216 //16M of tracked paths
+#define RETRY_BASE        100      //ms, first retry delay
+#define RETRY_MAX_DELAY   10000    //ms
+#define WHEEL_TICK        10       //ms per slot
+#define WHEEL_SLOTS       512
+
+class PurgeQueue{
+public:
+    using Clock = std::chrono::steady_clock;
+    enum {ADDED, COLLAPSED, FULL};
+
+    PurgeQueue(size_t max_entries, size_t max_bytes = PURGE_QUEUE_BYTES,
+               long retry_base = RETRY_BASE, long retry_max = RETRY_MAX_DELAY,
+               long tick_ms = WHEEL_TICK, size_t slots = WHEEL_SLOTS);
+
+    int push(const std::string& path);
+    int push(std::string&& path);
+    bool pop(std::string& path, int& tries);        //next ready path, it stays tracked
+    void retry(const std::string& path, int tries, Clock::time_point now = Clock::now());
+    void done(const std::string& path);             //purged or given up
+    void advance(Clock::time_point now = Clock::now());
+
+    size_t ready() const{return ready_queue.size();}
+    size_t scheduled() const{return scheduled_count;}
+    size_t tracked() const{return paths.size();}
+    size_t bytes() const{return tracked_bytes;}
+    uint64_t collapsed() const{return collapsed_count;}
+    long tick() const{return tick_ms;}
+
+private:
+    struct Timer{
+        std::string path;
+        int tries;
+        uint64_t expire;                            //in ticks
+    };
+
+    const size_t max_entries, max_bytes;
+    const long retry_base, retry_max, tick_ms;
+    std::unordered_set<std::string> paths;
+    std::deque<std::pair<std::string, int>> ready_queue;
+    std::vector<std::vector<Timer>> wheel;
+    const Clock::time_point epoch;
+    uint64_t current = 0;                           //last tick processed
+    size_t tracked_bytes = 0, scheduled_count = 0;
+    uint64_t collapsed_count = 0;
+
+    uint64_t to_tick(Clock::time_point tp) const;
+};
+
+#endif
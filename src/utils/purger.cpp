@@ -2,8 +2,10 @@
 
 void curl_easy_basic_opt(CURL* curl, long timeout){
         curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 1L);
+        curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
         curl_easy_setopt(curl, CURLOPT_MAXREDIRS, 3L);
         curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+        curl_easy_setopt(curl, CURLOPT_TCP_NODELAY, 1L);
         curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
         curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, timeout);
 //TODO:add source ip address support
@@ -18,118 +20,235 @@ Purger::Purger(FailCallback cb,
                const std::string& srv,
                const std::string& cmd,
                size_t q_max,
-               int th_max,
+               int in_max,
                int t_max,
-               long tim) :
+               long tim,
+               const std::shared_ptr<PurgeJournal>& jn,
+               const std::shared_ptr<RateController>& rc) :
                fail_callback(cb), purge_command(cmd),
-               queue_max(q_max), thread_max(th_max), try_max(t_max),
-               timeout(tim)
+               queue_max(q_max), inflight_max(in_max), try_max(t_max),
+               timeout(tim), purge_queue(q_max), journal(jn), controller(rc)
 { 
+    if(inflight_max <= 0 || try_max <= 0)throw std::runtime_error("purger: invalid args");
     if(srv.back() == '/')server_name = srv.substr(0, srv.size() - 1);
     else server_name = srv;
     
     curl_global_init(CURL_GLOBAL_DEFAULT);
-    for(int i = 0; i < thread_max; i++){
-        auto thread_ptr = std::make_unique<std::thread>(&Purger::worker, this);
-        thread_ptr->detach();
-        running_worker++;
-        std::cerr << "purge worker #" << i << " detached" << std::endl;
+    multi = curl_multi_init();
+    if(multi == nullptr)throw std::runtime_error("purger: curl_multi_init failed");
+    //one connection per in-flight request (no pipelining in HTTP/1.1), all kept alive
+    curl_multi_setopt(multi, CURLMOPT_MAX_HOST_CONNECTIONS, (long)inflight_max);
+    curl_multi_setopt(multi, CURLMOPT_MAXCONNECTS, (long)inflight_max);
+
+    for(int i = 0; i < inflight_max; i++){
+        auto req = std::make_unique<Request>();
+        req->curl = curl_easy_init();
+        if(req->curl == nullptr)throw std::runtime_error("purger: curl_easy_init failed");
+        curl_easy_basic_opt(req->curl, timeout);
+        curl_easy_setopt(req->curl, CURLOPT_CUSTOMREQUEST, purge_command.c_str());
+        curl_easy_setopt(req->curl, CURLOPT_WRITEDATA, &req->buffer);
+        curl_easy_setopt(req->curl, CURLOPT_WRITEFUNCTION, write_callback);
+        curl_easy_setopt(req->curl, CURLOPT_PRIVATE, req.get());
+        idle.push_back(req.get());
+        requests.push_back(std::move(req));
     }
+    if(controller)controller->clamp(inflight_max);
+    if(journal){
+        for(auto& it : journal->replay()){
+            if(purge_queue.push(it) == PurgeQueue::FULL){
+                std::cerr << "queue overflow! journal entry not recovered: " << it << std::endl;
+                journal->done(it);
+            }else{
+                recovered_count++;
+            }
+        }
+        if(recovered_count)std::cerr << "purger: " << recovered_count << " paths recovered from the journal" << std::endl;
+    }
+    loop_thread = std::thread(&Purger::loop, this);
 }
 
 Purger::~Purger(){
     stop();
+    for(auto& it : requests)curl_easy_cleanup(it->curl);
+    curl_multi_cleanup(multi);
     curl_global_cleanup();
 }
 
-void Purger::worker(){
-    CURL* curl = curl_easy_init();
-    CURLcode curl_code;
-    long http_code;
-    std::string buffer;
+//move queued paths to idle handles, called by the loop thread only
+//returns the ms to wait for the token bucket, 0 if not throttled
+long Purger::start_requests(){
+    size_t limit = inflight_max;
+    long throttled = 0;
+    if(controller){
+        controller->check_disk();
+        limit = controller->window();
+        if(controller->rate() != bucket.rate())bucket.set(controller->rate(), limit);
+    }
+    std::unique_lock<std::mutex>uni_lock(queue_lock);
+    purge_queue.advance();
+    while(idle.size() && inflight_count < limit && purge_queue.ready()){
+        if(controller && !bucket.try_take()){
+            throttled = bucket.wait_ms();
+            break;
+        }
+        Request* req = idle.back();
+        purge_queue.pop(req->path, req->tries);
+        idle.pop_back();
+        req->tries++;
+        req->buffer.clear();
+        curl_easy_setopt(req->curl, CURLOPT_URL, (server_name + req->path).c_str());
+        curl_multi_add_handle(multi, req->curl);
+        inflight_count++;
+    }
+    return throttled;
+}
 
-    curl_easy_basic_opt(curl, timeout);
+void Purger::finish_request(CURL* curl, CURLcode code){
+    Request* req;
+    long http_code = 0;
+    curl_easy_getinfo(curl, CURLINFO_PRIVATE, (char**)&req);
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
+    curl_multi_remove_handle(multi, curl);
+    inflight_count--;
+    if(controller){
+        curl_off_t total_us = 0;
+        curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME_T, &total_us);
+        controller->on_response(total_us / 1000.0, code != CURLE_OK || http_code >= 500);
+    }
 
-    while(true){
+    if(code == CURLE_OK && http_code == 200 && req->buffer.compare(0, 4, VALID_RESPONSE) == 0){
+        success_count++;
+        forget(req->path);
+    }else{
+        std::cerr << "purge failed: " << server_name + req->path << std::endl;
+        if(code != CURLE_OK)std::cerr << "curl error: " << curl_easy_strerror(code) << std::endl;
+        else std::cerr << "http code: " << http_code << ", response: " << req->buffer << std::endl;
         std::unique_lock<std::mutex>uni_lock(queue_lock);
-        if(purge_queue.empty() && !stop_signal){
-            worker_cv.wait(uni_lock,
-                           [this]{return stop_signal || purge_queue.size();});
-        }
-        
-        if(stop_signal){
-            curl_easy_cleanup(curl);
-            running_worker--;
-            return;
+        if(req->tries < try_max){
+            purge_queue.retry(req->path, req->tries);
+        }else{
+            uni_lock.unlock();
+            forget(req->path);
+            fail_count++;
+            fail_callback(req->path, req->tries);
         }
+    }
+    req->buffer.clear();
+    idle.push_back(req);
+}
 
-        auto task = purge_queue.front();
-        purge_queue.pop();
-        uni_lock.unlock();
-        task.second++;
-
-        curl_easy_setopt(curl, CURLOPT_URL, (server_name + task.first).c_str());
-        curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, purge_command.c_str());
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &buffer);
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
-        
-        curl_code = curl_easy_perform(curl);
-        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
-
-        if(http_code != 200 || buffer.substr(0, 4) != VALID_RESPONSE){
-            std::cerr << "purge failed: " << server_name + task.first << std::endl;
-            std::cerr << "http code: " << http_code << ", response: " << buffer << std::endl;
-            if(task.second < try_max){
-                uni_lock.lock();
-                if(purge_queue.size() < queue_max){
-                    std::cerr << "retry: " << server_name + task.first << std::endl;
-                    purge_queue.push(task);
-                    uni_lock.unlock();
-                    worker_cv.notify_one();
-                }else{
-                    std::cerr << "queue overflow!" << std::endl;
-                    fail_callback(task.first, task.second);
-                }
-            }else{
-                fail_callback(task.first, task.second);
+void Purger::forget(const std::string& path){
+    std::lock_guard<std::mutex>lock_gd(queue_lock);
+    purge_queue.done(path);
+    if(journal)journal->done(path);
+}
+
+void Purger::loop(){
+    int running = 0, msgs = 0;
+    auto last_sync = std::chrono::steady_clock::now();
+    while(!stop_signal){
+        if(journal && std::chrono::steady_clock::now() - last_sync >= std::chrono::milliseconds(PURGER_SYNC_INTVL)){
+            try{
+                journal->sync();
+            }catch(const std::exception& e){
+                std::cerr << "exception: " << e.what() << std::endl;
             }
-        }else{
-            std::cerr << "success: " << buffer << std::endl;
+            last_sync = std::chrono::steady_clock::now();
+        }
+        long throttled = start_requests();
+        curl_multi_perform(multi, &running);
+        while(CURLMsg* msg = curl_multi_info_read(multi, &msgs)){
+            if(msg->msg == CURLMSG_DONE)finish_request(msg->easy_handle, msg->data.result);
+        }
+        std::unique_lock<std::mutex>uni_lock(queue_lock);
+        if(!throttled && idle.size() && purge_queue.ready() &&
+           (!controller || inflight_count < controller->window()))continue; //new paths, start them right away
+        long wait = purge_queue.scheduled() ? purge_queue.tick() : PURGER_POLL;
+        if(journal)wait = std::min<long>(wait, PURGER_SYNC_INTVL);
+        if(throttled)wait = std::min(wait, throttled);
+        if(controller && controller->emergency())wait = std::min<long>(wait, DISK_CHECK_INTVL);
+        uni_lock.unlock();
+        curl_multi_poll(multi, nullptr, 0, wait, nullptr);
+    }
+    for(auto& it : requests){
+        if(std::find(idle.begin(), idle.end(), it.get()) == idle.end()){
+            curl_multi_remove_handle(multi, it->curl);
         }
-
-        buffer.clear();
     }
+    inflight_count = 0;
 }
 
 bool Purger::add(const std::string& path){
+    std::string full_path = path.front() == '/' ? path : '/' + path;
     std::unique_lock<std::mutex>uni_lock(queue_lock);
-    if(purge_queue.size() < queue_max){
-        if(path.front() == '/')purge_queue.emplace(path, 0);
-        else purge_queue.emplace('/' + path, 0);
-        uni_lock.unlock();
-        worker_cv.notify_one();
-        return 1;
+    if(journal)journal->add(full_path);    //no-op if already pending
+    int res = purge_queue.push(std::move(full_path));
+    if(res == PurgeQueue::FULL && journal)journal->done(full_path);
+    uni_lock.unlock();
+    if(res == PurgeQueue::ADDED)curl_multi_wakeup(multi);
+    else if(res == PurgeQueue::FULL){
+        std::cerr << "queue overflow!" << std::endl;
+        return 0;
     }
-    std::cerr << "queue overflow!" << std::endl;
-    return 0;    
+    return 1;
+}
+
+size_t Purger::add_batch(std::span<std::string> paths){
+    size_t accepted = 0, added = 0, dropped = 0;
+    std::unique_lock<std::mutex>uni_lock(queue_lock);
+    for(auto& it : paths){
+        if(it.empty())continue;
+        if(it.front() != '/')it.insert(it.begin(), '/');
+        if(journal)journal->add(it);
+        int res = purge_queue.push(std::move(it)); //left intact if full
+        if(res == PurgeQueue::FULL){
+            if(journal)journal->done(it);
+            dropped++;
+            continue;
+        }
+        accepted++;
+        added += (res == PurgeQueue::ADDED);
+    }
+    uni_lock.unlock();
+    if(added)curl_multi_wakeup(multi);
+    if(dropped)std::cerr << "queue overflow! " << dropped << " dropped" << std::endl;
+    return accepted;
 }
 
 size_t Purger::size() const{
     std::lock_guard<std::mutex>lock_gd(queue_lock);
-    return purge_queue.size();
+    return purge_queue.ready() + purge_queue.scheduled();
 }
 
-void Purger::stop(){
-    if(stop_signal)return;
-    
-    queue_lock.lock();
-    stop_signal = true;
-    queue_lock.unlock();
-    worker_cv.notify_all();
+size_t Purger::inflight() const{
+    return inflight_count;
+}
+
+size_t Purger::recovered() const{
+    return recovered_count;
+}
 
-    while(running_worker)std::this_thread::sleep_for(std::chrono::milliseconds(1));
-    //TODO: verify the memory order (all of the worker must quit with once notify)
+uint64_t Purger::succeeded() const{
+    return success_count;
+}
 
-    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+uint64_t Purger::failed() const{
+    return fail_count;
 }
 
+uint64_t Purger::collapsed() const{
+    std::lock_guard<std::mutex>lock_gd(queue_lock);
+    return purge_queue.collapsed();
+}
+
+void Purger::stop(){
+    if(stop_signal.exchange(true))return;
+    curl_multi_wakeup(multi);
+    if(loop_thread.joinable())loop_thread.join();
+    try{
+        if(journal)journal->sync();
+    }catch(const std::exception& e){
+        std::cerr << "exception: " << e.what() << std::endl;
+    }
+    //the requests in flight are abandoned, like the queued ones
+}
@@ -1,8 +1,35 @@
+/*
+ * Send PURGE requests to nginx (ngx_cache_purge)
+ * A single thread drives a curl multi handle: up to inflight_max requests
+ * are in flight at once, on keep-alive connections kept in the multi
+ * connection cache, each one bounded by the timeout. add() only queues
+ * the path and wakes the thread up (curl_multi_wakeup), it never blocks
+ * on the network.
+ *
+ * A request succeeds on a 200 whose body starts with VALID_RESPONSE,
+ * otherwise it is retried with a growing delay (see PurgeQueue) until
+ * try_max, then fail_callback is called (from the purger thread).
+ * A path already queued, in flight or waiting for a retry is not added
+ * twice.
+ *
+ * With a journal, the queued paths are recorded until they are done and
+ * the ones left by the previous run are queued again on construction.
+ * The journal is synced by the purger thread every PURGER_SYNC_INTVL.
+ *
+ * With a rate controller, the requests in flight are limited to its
+ * window and started at its rate (token bucket), which follow the
+ * latency of nginx, see RateController. Without one, inflight_max
+ * requests are sent as fast as possible.
+ */
+
+#ifndef PURGER_H
+#define PURGER_H
+
 #include <iostream>
 #include <thread>
-#include <queue>
+#include <vector>
+#include <span>
 #include <utility>
-#include <condition_variable>
 #include <string>
 #include <atomic>
 #include <mutex>
@@ -10,52 +37,87 @@
 #include <chrono>
 #include <functional>
 #include <algorithm>
+#include <stdexcept>
 #include "curl/curl.h"
+#include "purge_queue.h"
+#include "purge_journal.h"
+#include "rate_controller.h"
+#include "token_bucket.h"
 
 #define VALID_RESPONSE "Key:"
 #define DEFAULT_SERVER "http://127.0.0.1"
 #define DEFAULT_CMD "PURGE"
-#define QUEUE_MAX 1024
-#define THREAD_MAX 4
+#define QUEUE_MAX 1024 //paths queued, in flight or waiting for a retry
+#define INFLIGHT_MAX 256 //concurrent requests (and connections) to the server
 #define TRY_MAX 3
 #define TIMEOUT 1000 //ms
+#define PURGER_POLL 1000 //ms, curl_multi_poll upper bound
+#define PURGER_SYNC_INTVL 200 //ms between two journal syncs
 
 class Purger{
 public:
     //TODO: add bind address
-    //TODO: make logging system thread safe
     using FailCallback = std::function<void(const std::string, int)>;
     Purger(FailCallback callback, 
            const std::string& server = DEFAULT_SERVER,
            const std::string& command = DEFAULT_CMD,
            size_t queue_max = QUEUE_MAX,
-           int thread_max = THREAD_MAX,
+           int inflight_max = INFLIGHT_MAX,
            int try_max = TRY_MAX,
-           long timeout = TIMEOUT);
+           long timeout = TIMEOUT,
+           const std::shared_ptr<PurgeJournal>& journal = nullptr,
+           const std::shared_ptr<RateController>& controller = nullptr);
 
     ~Purger();
     
-    bool add(const std::string& path);
-    size_t size() const;
+    bool add(const std::string& path);  //false if the queue is full
+    size_t add_batch(std::span<std::string> paths);
+    //the paths are moved from, one lock and one wakeup for the batch,
+    //returns how many were accepted (the rest is dropped, queue full)
+    size_t size() const;                //queued or waiting for a retry, not in flight
+    size_t inflight() const;
+    size_t recovered() const;           //paths replayed from the journal
+    uint64_t succeeded() const;
+    uint64_t failed() const;            //gave up after try_max
+    uint64_t collapsed() const;         //duplicate paths not added
     void stop();
     
     
 private:
+    struct Request{
+        CURL* curl = nullptr;
+        std::string path;
+        int tries = 0;
+        std::string buffer;
+    };
+
     FailCallback fail_callback;
     std::string server_name;
     const std::string purge_command;
     const size_t queue_max;
-    const int thread_max, try_max;
+    const int inflight_max, try_max;
     const long timeout;
 
-    std::queue<std::pair<const std::string, int>> purge_queue;
+    PurgeQueue purge_queue;
+    std::shared_ptr<PurgeJournal> journal;
+    size_t recovered_count = 0;
+    std::shared_ptr<RateController> controller;
+    TokenBucket bucket;
     mutable std::mutex queue_lock;
     std::atomic<bool>stop_signal = 0;
-    std::atomic<int>running_worker = 0;
-    std::condition_variable worker_cv;
+    std::atomic<size_t>inflight_count = 0;
+    std::atomic<uint64_t>success_count = 0, fail_count = 0;
 
-    void worker();
+    CURLM* multi = nullptr;
+    std::vector<std::unique_ptr<Request>> requests;
+    std::vector<Request*> idle;         //easy handles are reused with their state
+    std::thread loop_thread;
 
-};
+    long start_requests();
+    void finish_request(CURL* curl, CURLcode code);
+    void forget(const std::string& path);
+    void loop();
 
+};
 
+#endif
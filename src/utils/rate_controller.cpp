@@ -0,0 +1,78 @@
+#include "rate_controller.h"
+
+RateController::RateController() : RateController(Options()) {}
+
+RateController::RateController(const Options& opt) : options(opt){
+    if(opt.min_window == 0 || opt.max_window < opt.min_window || opt.target_latency <= 0 ||
+       opt.decrease <= 0 || opt.decrease >= 1 || opt.headroom < 0 || opt.headroom >= 1){
+        throw std::runtime_error("rate controller: invalid args");
+    }
+    cur_window = std::clamp(opt.init_window, opt.min_window, opt.max_window);
+}
+
+void RateController::clamp(size_t max){
+    options.max_window = std::max(std::min(options.max_window, max), (size_t)1);
+    options.min_window = std::min(options.min_window, options.max_window);
+    options.emergency_window = std::min(options.emergency_window, max);
+    cur_window = std::clamp(cur_window.load(), options.min_window, options.max_window);
+}
+
+void RateController::on_response(double latency_ms, bool error){
+    double ewma = latency_ewma;
+    latency_ewma = ewma > 0 ? ewma * 0.8 + latency_ms * 0.2 : latency_ms;
+    round_count++;
+    round_sum += latency_ms;
+    round_error |= error;
+    size_t window = cur_window;
+    if(round_count < window)return;
+
+    if(round_error || round_sum / round_count > options.target_latency){
+        window = std::max(options.min_window, static_cast<size_t>(window * options.decrease));
+        backoff_count++;
+    }else{
+        window = std::min(options.max_window, window + options.increase);
+    }
+    cur_window = window;
+    round_count = 0;
+    round_sum = 0;
+    round_error = false;
+}
+
+bool RateController::check_disk(std::chrono::steady_clock::time_point now){
+    if(options.disk_path.empty() || forced)return emergency_mode;
+    if(now - last_check < std::chrono::milliseconds(DISK_CHECK_INTVL))return emergency_mode;
+    last_check = now;
+
+    struct statvfs st;
+    if(statvfs(options.disk_path.c_str(), &st) || st.f_blocks == 0)return emergency_mode;
+    double free_ratio = static_cast<double>(st.f_bavail) / st.f_blocks;
+    double pending = options.pending_free ? static_cast<double>(options.pending_free()) / st.f_frsize / st.f_blocks : 0;
+    if(!emergency_mode && free_ratio + pending < options.headroom){
+        std::cerr << "purger: " << options.disk_path << " is " << (1 - free_ratio) * 100
+        << "% full, emergency mode" << std::endl;
+        emergency_mode = true;
+    }else if(emergency_mode && free_ratio > options.headroom * 2){
+        std::cerr << "purger: " << options.disk_path << " back to " << free_ratio * 100
+        << "% free, leaving emergency mode" << std::endl;
+        emergency_mode = false;
+    }
+    return emergency_mode;
+}
+
+void RateController::set_emergency(bool on){
+    forced = on;
+    emergency_mode = on;
+}
+
+size_t RateController::window() const{
+    if(emergency_mode)return std::max(cur_window.load(), options.emergency_window);
+    return cur_window;
+}
+
+double RateController::rate() const{
+    if(emergency_mode)return options.emergency_rate;
+    //what the window sustains at the larger of the measured and the target latency
+    double rate = cur_window * 1000.0 / std::max(latency_ewma.load(), options.target_latency);
+    if(options.max_rate > 0)rate = std::min(rate, options.max_rate);
+    return rate;
+}
@@ -0,0 +1,85 @@
+/*
+ * Pacing of the PURGE requests from the latency of nginx (AIMD)
+ * The responses are taken in rounds of window() requests: if one of them
+ * failed (curl error or 5xx) or the average latency of the round is above
+ * target_latency, the window is multiplied by decrease, otherwise it
+ * grows by increase. rate() spreads the window over the measured latency
+ * (Little's law), the purger feeds it to a TokenBucket so a burst of
+ * evictions is sent at that pace instead of all at once.
+ *
+ * Emergency: when the free space of disk_path drops below headroom
+ * (a fraction of the filesystem), the window is raised to
+ * emergency_window and the rate to emergency_rate (0: no limit), freeing
+ * space first. It ends when the free space is back above twice the
+ * headroom. set_emergency() forces it from outside. pending_free (e.g.
+ * AsyncDeleter::pending_bytes) is counted as free when deciding to enter
+ * it, so space already on its way out does not trigger more evictions.
+ */
+
+#ifndef RATE_CONTROLLER_H
+#define RATE_CONTROLLER_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include <sys/statvfs.h>
+
+#define TARGET_LATENCY   50      //ms
+#define WINDOW_MIN       2
+#define WINDOW_INIT      16
+#define WINDOW_INCREASE  1
+#define WINDOW_DECREASE  0.5
+#define EMERGENCY_HEADROOM 0.05  //of the filesystem
+#define DISK_CHECK_INTVL 1000    //ms
+
+class RateController{
+public:
+    struct Options{
+        double target_latency = TARGET_LATENCY;
+        size_t min_window = WINDOW_MIN;
+        size_t max_window = 256;             //clamped to the purger's inflight_max
+        size_t init_window = WINDOW_INIT;
+        size_t increase = WINDOW_INCREASE;
+        double decrease = WINDOW_DECREASE;
+        double max_rate = 0;                 //requests/s, 0: no limit
+        std::string disk_path;               //empty: no emergency mode from disk
+        double headroom = EMERGENCY_HEADROOM;
+        size_t emergency_window = 256;
+        double emergency_rate = 0;
+        std::function<uint64_t()> pending_free; //bytes queued for deletion
+    };
+
+    RateController();
+    explicit RateController(const Options& opt);
+
+    void on_response(double latency_ms, bool error);
+    bool check_disk(std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now());
+    void set_emergency(bool on);
+    void clamp(size_t max);                  //set by the purger
+
+    size_t window() const;
+    double rate() const;                     //0: no limit
+    bool emergency() const{return emergency_mode;}
+    double latency() const{return latency_ewma;}
+    uint64_t backoffs() const{return backoff_count;}
+
+private:
+    Options options;
+    std::atomic<size_t> cur_window;
+    std::atomic<bool> emergency_mode = false, forced = false;
+    std::atomic<double> latency_ewma = 0;
+    std::atomic<uint64_t> backoff_count = 0;
+    size_t round_count = 0;
+    double round_sum = 0;
+    bool round_error = false;
+    std::chrono::steady_clock::time_point last_check;
+};
+
+#endif
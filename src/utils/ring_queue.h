@@ -0,0 +1,101 @@
+/*
+ * Bounded lock-free ring queue (Dmitry Vyukov's bounded MPMC algorithm)
+ * Every cell carries a sequence number, so producers and consumers only
+ * contend on their own index. It is safe for any number of producers and
+ * consumers, we use it as MPSC (receiver threads -> parser) and SPSC.
+ *
+ * T must be default constructible and movable (e.g. BufferPool::Lease).
+ */
+
+#ifndef RING_QUEUE_H
+#define RING_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <utility>
+
+template<typename T>
+class RingQueue{
+public:
+    explicit RingQueue(size_t capacity) : mask(capacity - 1){
+        if(capacity < 2 || (capacity & (capacity - 1))){
+            throw std::runtime_error("ring queue: capacity must be a power of 2");
+        }
+        cells = std::make_unique<Cell[]>(capacity);
+        for(size_t i = 0; i < capacity; i++){
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        enqueue_pos.store(0, std::memory_order_relaxed);
+        dequeue_pos.store(0, std::memory_order_relaxed);
+    }
+
+    RingQueue(const RingQueue&) = delete;
+    RingQueue& operator=(const RingQueue&) = delete;
+
+    bool try_push(T&& data){ //false if full, data is untouched then
+        size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+        Cell* cell;
+        while(true){
+            cell = &cells[pos & mask];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if(diff == 0){
+                if(enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))break;
+            }else if(diff < 0){
+                return false;
+            }else{
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        cell->data = std::move(data);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool try_pop(T& data){ //false if empty
+        size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+        Cell* cell;
+        while(true){
+            cell = &cells[pos & mask];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+            if(diff == 0){
+                if(dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))break;
+            }else if(diff < 0){
+                return false;
+            }else{
+                pos = dequeue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        data = std::move(cell->data);
+        cell->sequence.store(pos + mask + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t size_approx() const{
+        size_t head = dequeue_pos.load(std::memory_order_relaxed);
+        size_t tail = enqueue_pos.load(std::memory_order_relaxed);
+        return tail > head ? tail - head : 0;
+    }
+
+    size_t capacity() const{return mask + 1;}
+
+private:
+    struct Cell{
+        std::atomic<size_t> sequence;
+        T data;
+    };
+
+    static constexpr size_t CACHE_LINE = 64;
+
+    const size_t mask;
+    std::unique_ptr<Cell[]> cells;
+    alignas(CACHE_LINE) std::atomic<size_t> enqueue_pos;
+    alignas(CACHE_LINE) std::atomic<size_t> dequeue_pos;
+};
+
+#endif
@@ -0,0 +1,99 @@
+/*
+ * Syslog header skipper (nginx "access_log syslog:..." and rsyslog relays)
+ * Return the MSG part of a RFC 3164 or RFC 5424 message without regex,
+ * e.g. "<190>Jan  1 00:00:00 host nginx: {...}" -> "{...}"
+ *
+ * Only the header is walked (no copy, no validation of the timestamp),
+ * a message without "<PRI>" is returned as it is, so plain JSON lines can
+ * go through the same path.
+ */
+
+#ifndef SYSLOG_H
+#define SYSLOG_H
+
+#include <algorithm>
+#include <cstddef>
+#include <string_view>
+
+#define SYSLOG_TAG_MAX 48 //RFC 3164 says 32, be tolerant
+
+namespace syslog_header{
+
+inline bool is_digit(char c){return c >= '0' && c <= '9';}
+
+//skip one SP-terminated field, npos if the message ends first
+inline size_t skip_field(std::string_view msg, size_t pos){
+    size_t end = msg.find(' ', pos);
+    return end == std::string_view::npos ? end : end + 1;
+}
+
+//STRUCTURED-DATA: "-" or one or more "[id param="value"...]", '\]' is escaped
+inline size_t skip_structured(std::string_view msg, size_t pos){
+    if(pos >= msg.size())return std::string_view::npos;
+    if(msg[pos] == '-')return pos + 1;
+    while(pos < msg.size() && msg[pos] == '['){
+        bool quoted = false;
+        for(pos++; pos < msg.size(); pos++){
+            char c = msg[pos];
+            if(c == '\\' && quoted){pos++; continue;}
+            if(c == '"')quoted = !quoted;
+            else if(c == ']' && !quoted)break;
+        }
+        if(pos >= msg.size())return std::string_view::npos;
+        pos++;
+    }
+    return pos;
+}
+
+//"Mmm dd hh:mm:ss " (dd is space padded)
+inline bool is_bsd_time(std::string_view msg, size_t pos){
+    return msg.size() >= pos + 16 && msg[pos + 3] == ' ' && msg[pos + 6] == ' ' &&
+           msg[pos + 9] == ':' && msg[pos + 12] == ':' && msg[pos + 15] == ' ';
+}
+
+}
+
+inline std::string_view syslog_payload(std::string_view msg){
+    using namespace syslog_header;
+    if(msg.size() < 3 || msg[0] != '<')return msg;
+
+    size_t pos = 1;
+    while(pos < msg.size() && pos <= 3 && is_digit(msg[pos]))pos++;
+    if(pos == 1 || pos >= msg.size() || msg[pos] != '>')return msg; //not a PRI
+    pos++;
+
+    if(pos + 1 < msg.size() && is_digit(msg[pos]) && (msg[pos + 1] == ' ' ||
+       (is_digit(msg[pos + 1]) && pos + 2 < msg.size() && msg[pos + 2] == ' '))){
+        //RFC 5424: VERSION TIMESTAMP HOSTNAME APP-NAME PROCID MSGID SD [MSG]
+        for(int i = 0; i < 6 && pos != std::string_view::npos; i++){
+            pos = skip_field(msg, pos);
+        }
+        pos = skip_structured(msg, pos);
+        if(pos == std::string_view::npos || pos >= msg.size())return {};
+        if(msg[pos] == ' ')pos++;
+        if(msg.substr(pos, 3) == "\xEF\xBB\xBF")pos += 3; //BOM
+        return msg.substr(pos);
+    }
+
+    //RFC 3164: [TIMESTAMP HOSTNAME ]TAG[PID]: MSG, every part may be missing
+    if(is_bsd_time(msg, pos)){
+        pos += 16;
+        size_t host_end = msg.find(' ', pos);
+        size_t colon = msg.find(':', pos);
+        if(host_end != std::string_view::npos && host_end < colon)pos = host_end + 1;
+    }//nginx always sends a hostname, a colon before the space means there is none
+
+    size_t limit = std::min(msg.size(), pos + SYSLOG_TAG_MAX);
+    for(size_t i = pos; i < limit; i++){
+        char c = msg[i];
+        if(c == ':'){
+            pos = i + 1;
+            if(pos < msg.size() && msg[pos] == ' ')pos++;
+            break;
+        }
+        if(c == ' ' || c == '{')break; //no tag, the rest is MSG
+    }
+    return msg.substr(pos);
+}
+
+#endif
@@ -0,0 +1,70 @@
+/*
+ * Token bucket: rate tokens per second, at most burst in reserve
+ * A rate of 0 means no limit. Not thread-safe.
+ * try_take() takes one token if there is one; consume() takes any amount
+ * (e.g. bytes) and may go into debt, debt_ms() is the time to repay it.
+ */
+
+#ifndef TOKEN_BUCKET_H
+#define TOKEN_BUCKET_H
+
+#include <algorithm>
+#include <chrono>
+
+class TokenBucket{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    TokenBucket(double rate = 0, double burst = 1) : token_rate(rate), max_tokens(std::max(burst, 1.0)),
+                                                     tokens(max_tokens), last(Clock::now()) {}
+
+    void set(double rate, double burst){
+        refill(Clock::now());
+        token_rate = rate;
+        max_tokens = std::max(burst, 1.0);
+        tokens = std::min(tokens, max_tokens);
+    }
+
+    bool try_take(Clock::time_point now = Clock::now()){
+        if(token_rate <= 0)return true;
+        refill(now);
+        if(tokens < 1)return false;
+        tokens -= 1;
+        return true;
+    }
+
+    //ms until the next token, 0 if there is one
+    long wait_ms(Clock::time_point now = Clock::now()){
+        if(token_rate <= 0)return 0;
+        refill(now);
+        if(tokens >= 1)return 0;
+        return static_cast<long>((1 - tokens) * 1000 / token_rate) + 1;
+    }
+
+    void consume(double n, Clock::time_point now = Clock::now()){
+        if(token_rate <= 0)return;
+        refill(now);
+        tokens -= n;
+    }
+
+    long debt_ms(Clock::time_point now = Clock::now()){
+        if(token_rate <= 0)return 0;
+        refill(now);
+        if(tokens >= 0)return 0;
+        return static_cast<long>(-tokens * 1000 / token_rate) + 1;
+    }
+
+    double rate() const{return token_rate;}
+
+private:
+    double token_rate, max_tokens, tokens;
+    Clock::time_point last;
+
+    void refill(Clock::time_point now){
+        if(now <= last)return;
+        tokens = std::min(max_tokens, tokens + std::chrono::duration<double>(now - last).count() * token_rate);
+        last = now;
+    }
+};
+
+#endif
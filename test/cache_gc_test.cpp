@@ -0,0 +1,83 @@
+#include "cache_gc.h"
+#include "direct_purger.h"
+#include <fstream>
+#include <random>
+
+//usage: cache_gc_test [files] [directory]
+//fills a levels=1:2 tree with tracked files, orphans, variants, a young
+//orphan and an open orphan, one pass must remove exactly the garbage
+
+std::string root = "/tmp/x_cache_manager_gc_test";
+
+std::atomic<size_t> failed = 0;
+
+void fail_cb(const std::string& file, std::error_code ec) noexcept{
+    std::cerr << "failed: " << file << ": " << ec.message() << std::endl;
+    failed++;
+}
+
+void create(const std::string& file, bool old = true){
+    fs::create_directories(fs::path(file).parent_path());
+    std::ofstream(file) << std::string(1000, 'x');
+    if(old){
+        struct timespec times[2] = {{time(nullptr) - 3600, 0}, {time(nullptr) - 3600, 0}};
+        utimensat(AT_FDCWD, file.c_str(), times, 0);
+    }
+}
+
+size_t count_files(){
+    size_t res = 0;
+    for(auto& it : fs::recursive_directory_iterator(root))res += it.is_regular_file();
+    return res;
+}
+
+int main(int argc, char** argv){
+    size_t count = argc > 1 ? std::stoull(argv[1]) : 20000;
+    if(argc > 2)root = std::string(argv[2]) + "/x_cache_manager_gc_test";
+    fs::remove_all(root);
+    CachePath cache_path(root, "1:2");
+    AsyncDeleter deleter(2, fail_cb);
+    DirectPurger purger(deleter, cache_path, "https://pypi.org");
+
+    std::vector<std::string> paths;
+    for(size_t i = 0; i < count; i++)paths.push_back("/packages/pkg" + std::to_string(i) + ".whl");
+    for(auto& it : paths)create(purger.file(it));
+    size_t orphans = count / 10, variants = count / 20;
+    for(size_t i = 0; i < orphans; i++)create(purger.file("/orphan/" + std::to_string(i)));
+    for(size_t i = 0; i < variants; i++)create(purger.file(paths[i]) + ".0000000" + std::to_string(100 + i % 900));
+    create(purger.file("/orphan/young"), false);
+    std::string open_file = purger.file("/orphan/open");
+    create(open_file);
+    int held = open(open_file.c_str(), O_RDONLY);
+    create(root + "/temp/1/00/0000000001");    //not part of the levels layout
+    create(root + "/c/not_a_cache_file");
+    size_t total = count_files();
+
+    std::vector<Md5Digest> tracked;
+    purger.digests(paths, tracked);
+    CacheGC::Options opt;
+    opt.threads = 4;
+    CacheGC gc(deleter, cache_path, opt);
+    deleter.run();
+    auto start = std::chrono::steady_clock::now();
+    gc.start(std::move(tracked));
+    while(gc.progress().running){
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        auto p = gc.progress();
+        std::cout << "  " << p.dirs_done << " / " << p.dirs_total << " dirs, " << p.scanned << " scanned" << std::endl;
+    }
+    gc.wait();
+    deleter.stop();
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    close(held);
+
+    auto p = gc.progress();
+    size_t left = count_files();
+    std::cout << p.scanned << " entries in " << sec << "s, orphans: " << p.orphans << " / " << orphans
+    << ", variants: " << p.variants << " / " << variants << ", young: " << p.young << ", open: " << p.busy
+    << ", left: " << left << " / " << total - orphans - variants << std::endl;
+    bool ok = p.orphans == orphans && p.variants == variants && p.young == 1 && p.busy == 1 &&
+              left == total - orphans - variants && fs::exists(open_file) && failed == 0;
+    fs::remove_all(root);
+    return ok ? 0 : 1;
+}
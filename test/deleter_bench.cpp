@@ -0,0 +1,111 @@
+#include "async_deleter.h"
+#include "cache_path.h"
+#include <random>
+
+//usage: deleter_bench [files] [threads] [batch size] [directory]
+//fills an nginx cache tree (levels=1:2) under the directory (/tmp by
+//default, e.g. /dev/shm for tmpfs) and removes it in eviction order:
+//submit() per file, add_batch() on the thread pool, add_batch() with io_uring,
+//then add_batch() under an I/O budget of files/4 per second, lifted by the
+//emergency mode after one second
+
+std::string bench_root = "/tmp/x_cache_manager_deleter_bench";
+
+std::atomic<size_t> failed = 0;
+
+void fail_cb(const std::string& file, std::error_code ec) noexcept{
+    failed++;
+}
+
+std::vector<std::string> fill(size_t count){
+    CachePath cache_path(bench_root, "1:2");
+    std::mt19937 rng(42);
+    std::vector<std::string> files;
+    std::string data(65536, 'x');
+    for(size_t i = 0; i < count; i++){
+        std::string file = cache_path.path("https://pypi.org/packages/pkg" + std::to_string(i) + ".whl");
+        fs::create_directories(fs::path(file).parent_path());
+        std::ofstream(file).write(data.data(), 4096 + rng() % (data.size() - 4096));
+        files.push_back(file);
+    }
+    std::shuffle(files.begin(), files.end(), rng); //eviction order is not directory order
+    sync();
+    return files;
+}
+
+bool report(const std::string& name, AsyncDeleter& deleter, std::pair<uint64_t, uint64_t> before,
+            std::chrono::steady_clock::time_point start, size_t count){
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    auto [files, bytes] = deleter.freed();
+    files -= before.first;
+    bytes -= before.second;
+    size_t left = 0;
+    for(auto& it : fs::recursive_directory_iterator(bench_root))left += it.is_regular_file();
+    std::cout << name << files / sec << " files/s, " << bytes / sec / 1048576 << " MB/s freed, removed: "
+    << files << " / " << count << ", left: " << left << std::endl;
+    return files == count && left == 0;
+}
+
+int main(int argc, char** argv){
+    size_t count = argc > 1 ? std::stoull(argv[1]) : 20000;
+    size_t threads = argc > 2 ? std::stoull(argv[2]) : 4;
+    size_t batch = argc > 3 ? std::stoull(argv[3]) : 512;
+    if(argc > 4)bench_root = std::string(argv[4]) + "/x_cache_manager_deleter_bench";
+    bool ok = true;
+    AsyncDeleter deleter(threads, fail_cb);
+    AsyncDeleter uring_deleter(threads, fail_cb, true);
+
+    fs::remove_all(bench_root);
+    auto files = fill(count);
+    deleter.run();
+    auto before = deleter.freed();
+    auto start = std::chrono::steady_clock::now();
+    for(auto& it : files)deleter.submit(it);
+    deleter.stop();
+    ok &= report("submit:    ", deleter, before, start, count);
+
+    files = fill(count);
+    deleter.run();
+    before = deleter.freed();
+    start = std::chrono::steady_clock::now();
+    for(size_t i = 0; i < files.size(); i += batch){
+        deleter.add_batch(std::span(files).subspan(i, std::min(batch, files.size() - i)));
+    }
+    deleter.stop();
+    ok &= report("add_batch: ", deleter, before, start, count);
+
+    if(uring_deleter.uring_enabled()){
+        files = fill(count);
+        uring_deleter.run();
+        start = std::chrono::steady_clock::now();
+        for(size_t i = 0; i < files.size(); i += batch){
+            uring_deleter.add_batch(std::span(files).subspan(i, std::min(batch, files.size() - i)));
+        }
+        uring_deleter.stop();
+        ok &= report("io_uring:  ", uring_deleter, {0, 0}, start, count);
+    }
+
+    files = fill(count);
+    std::vector<uint64_t> sizes;
+    for(auto& it : files)sizes.push_back(fs::file_size(it));
+    deleter.set_budget(count / 4.0, 0);
+    deleter.run();
+    before = deleter.freed();
+    start = std::chrono::steady_clock::now();
+    for(size_t i = 0; i < files.size(); i += batch){
+        size_t len = std::min(batch, files.size() - i);
+        deleter.add_batch(std::span(files).subspan(i, len), std::span(sizes).subspan(i, len));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    std::cout << "budget: pending " << deleter.pending_bytes() / 1048576 << " MB after 0.5s, removed "
+    << deleter.freed().first - before.first << std::endl;
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    deleter.set_emergency(true);
+    deleter.stop();
+    ok &= report("budget:    ", deleter, before, start, count);
+    ok &= deleter.pending_bytes() == 0;
+
+    std::cout << "failed: " << failed << std::endl;
+    fs::remove_all(bench_root);
+    return ok && failed == 0 ? 0 : 1;
+}
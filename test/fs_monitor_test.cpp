@@ -0,0 +1,89 @@
+#include "fs_monitor.h"
+#include "algo_lru.h"
+#include <fstream>
+
+//usage: fs_monitor_test [files] [directory]
+//nginx-like writes (temp file renamed in place, in level directories
+//created on demand), rewrites and deletes; the coalesced events feed an
+//LRU with the allocated size of each file
+
+std::string root = "/tmp/x_cache_manager_monitor_test";
+const std::string prefix = "https://pypi.org";
+
+std::atomic<size_t> written = 0, deleted = 0, batches = 0;
+
+std::string header(const std::string& key){
+    return std::string(64, '\0') + "\nKEY: " + prefix + key + "\n";
+}
+
+void write_cache(const CachePath& cache_path, const std::string& key, size_t size){
+    std::string file = cache_path.path(prefix + key);
+    fs::create_directories(fs::path(file).parent_path());
+    std::string temp = file + ".0000000001";
+    std::ofstream(temp) << header(key) << std::string(size, 'x');
+    rename(temp.c_str(), file.c_str());
+}
+
+void wait_for(size_t w, size_t d){
+    auto start = std::chrono::steady_clock::now();
+    while((written < w || deleted < d) && std::chrono::steady_clock::now() - start < std::chrono::seconds(5)){
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(2 * MONITOR_BATCH_INTVL));
+}
+
+int main(int argc, char** argv){
+    size_t count = argc > 1 ? std::stoull(argv[1]) : 2000;
+    if(argc > 2)root = std::string(argv[2]) + "/x_cache_manager_monitor_test";
+    fs::remove_all(root);
+    fs::create_directories(root + "/0/00");     //one level directory exists before init
+    CachePath cache_path(root, "1:2");
+
+    LRU lru(1ULL << 40, [](std::vector<LRU::Cache>&&){});
+    std::vector<std::string> keys;
+    for(size_t i = 0; i < count; i++){
+        keys.push_back("/packages/pkg" + std::to_string(i) + ".whl");
+        lru.put({keys.back(), 1, 0, {}});      //size unknown until written
+    }
+
+    Monitor monitor(cache_path, [&](std::vector<Monitor::Event>&& batch){
+        batches++;
+        for(auto& it : batch){
+            if(it.type == Monitor::DELETED){
+                deleted++;
+                continue;
+            }
+            written++;
+            if(it.key.size())lru.update(it.key, it.size);
+        }
+    }, prefix);
+    monitor.init();
+    monitor.run();
+
+    for(size_t i = 0; i < count; i++)write_cache(cache_path, keys[i], 1000 + i);
+    wait_for(count, 0);
+    std::cout << "written: " << written << " / " << count << " in " << batches << " batches, "
+    << monitor.watches() << " watches" << std::endl;
+    bool ok = written == count;
+
+    //rewritten several times within a batch: reported once, with the last size
+    written = 0;
+    for(int round = 0; round < 5; round++)write_cache(cache_path, keys[0], 100000 * (round + 1));
+    for(size_t i = 1; i < count / 2; i++)unlink(cache_path.path(prefix + keys[i]).c_str());
+    wait_for(1, count / 2 - 1);
+    struct stat st;
+    stat(cache_path.path(prefix + keys[0]).c_str(), &st);
+    std::cout << "rewritten: " << written << ", deleted: " << deleted << " / " << count / 2 - 1
+    << ", size: " << lru.query(keys[0]).size << " / " << st.st_blocks * 512 << std::endl;
+    ok &= written == 1 && deleted == count / 2 - 1 && lru.query(keys[0]).size == static_cast<size_t>(st.st_blocks * 512);
+
+    size_t sized = 0;
+    for(size_t i = count / 2; i < count; i++)sized += lru.query(keys[i]).size > 1;
+    std::cout << "sizes updated: " << sized << " / " << count - count / 2 << ", raw events: " << monitor.events()
+    << ", delivered: " << monitor.delivered() << ", overflows: " << monitor.overflows() << std::endl;
+    ok &= sized == count - count / 2;
+
+    monitor.stop();
+    fs::remove_all(root);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,66 @@
+#include "log_importer.h"
+#include <cstdio>
+#include <iostream>
+
+//usage: log_importer_test [lines per file] [threads] [existing logs...]
+
+#define FILE_A "/tmp/x_cache_manager_import_a.log"
+#define FILE_B "/tmp/x_cache_manager_import_b.log"
+
+std::vector<std::string> keys = {"time", "request", "status", "body_bytes_sent"};
+
+//two nginx instances, their requests interleave in time
+void make_log(const std::string& path, size_t lines, int start){
+    FILE* file = fopen(path.c_str(), "w");
+    std::string chunk;
+    for(size_t i = 0; i < lines; i++){
+        uint64_t ms = 1735689600000ull + (i * 2 + start) * 7;
+        chunk += R"({"time":")" + std::to_string(ms / 1000) + "." + std::to_string(1000 + ms % 1000).substr(1) +
+                 R"(","request":"GET /packages/pkg)" + std::to_string(i % 5000) +
+                 R"(.whl HTTP/1.1","status":200,"body_bytes_sent":)" + std::to_string(i * 31 % 100000) + "}\n";
+        if(i % 1000 == 0)chunk += "broken line\n";
+        if(chunk.size() > 65536){
+            fwrite(chunk.data(), 1, chunk.size(), file);
+            chunk.clear();
+        }
+    }
+    fwrite(chunk.data(), 1, chunk.size(), file);
+    fclose(file);
+}
+
+int main(int argc, char** argv){
+    size_t lines = argc > 1 ? std::stoull(argv[1]) : 2000000;
+    size_t threads = argc > 2 ? std::stoull(argv[2]) : IMPORT_THREADS;
+    std::vector<std::string> paths;
+    for(int i = 3; i < argc; i++)paths.push_back(argv[i]);
+    if(paths.empty()){
+        make_log(FILE_A, lines, 0);
+        make_log(FILE_B, lines, 1);
+        paths = {FILE_A, FILE_B};
+    }
+
+    using Importer = LogImporter<>;
+    std::cout << Importer::timestamp_ms(std::string("2025-01-01T00:00:10+08:00")) << " "
+    << Importer::timestamp_ms(std::string("01/Jan/2025:00:00:10 +0800")) << " "
+    << Importer::timestamp_ms(std::string("2024-12-31T16:00:10.250Z")) << " "
+    << Importer::timestamp_ms(1735660810.5) << std::endl; //1735660810000 x2, 1735660810250, 1735660810500
+
+    Importer importer(keys, "time", threads, 4194304);
+    uint64_t last = 0;
+    size_t unordered = 0;
+    auto report = importer.run(paths, [&](std::vector<Parser::LogValue>& values){
+        uint64_t time = Importer::timestamp_ms(values[0]);
+        if(time < last)unordered++;
+        last = time;
+    });
+
+    std::cout << "imported: " << report.lines << " lines (" << report.broken << " broken) from "
+    << report.chunks << " chunks, " << report.bytes / 1048576 << " MB in " << report.seconds << "s, "
+    << report.lines_per_sec << " lines/s, out of order: " << unordered << std::endl;
+
+    if(argc <= 3){
+        unlink(FILE_A);
+        unlink(FILE_B);
+    }
+    return unordered == 0 ? 0 : 1;
+}
@@ -0,0 +1,83 @@
+#include "log_tailer.h"
+#include <cstdio>
+#include <mutex>
+
+#define LOG_PATH  "/tmp/x_cache_manager_tail_test.log"
+#define CKPT_PATH "/tmp/x_cache_manager_tail_test.ckpt"
+
+std::atomic<size_t> received = 0, bytes = 0, broken = 0;
+
+void callback(std::span<std::string_view> batch){ //called concurrently in catch-up
+    received += batch.size();
+    for(auto it : batch){
+        bytes += it.size();
+        if(it.front() != '{' || it.back() != '}')broken++;
+    }
+}
+
+void append(const std::string& path, size_t lines){
+    std::string msg = R"({"time":"2025-01-01T00:00:00+00:00","request":"GET /packages/foo.whl HTTP/1.1","status":200})";
+    std::string chunk;
+    FILE* file = fopen(path.c_str(), "a");
+    for(size_t i = 0; i < lines; i++){
+        chunk += msg;
+        chunk += '\n';
+        if(chunk.size() > 65536 || i + 1 == lines){
+            fwrite(chunk.data(), 1, chunk.size(), file);
+            chunk.clear();
+        }
+    }
+    fclose(file);
+}
+
+void wait_for(size_t total){
+    auto start = std::chrono::steady_clock::now();
+    while(received < total && std::chrono::steady_clock::now() - start < std::chrono::seconds(5)){
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+int main(int argc, char** argv){
+    size_t total = argc > 1 ? std::stoull(argv[1]) : 1000000;
+    unlink(LOG_PATH);
+    unlink(CKPT_PATH);
+    unlink(LOG_PATH ".1");
+
+    //backlog, read by the catch-up threads
+    append(LOG_PATH, total);
+    auto start = std::chrono::steady_clock::now();
+    LogTailer* tailer = new LogTailer(LOG_PATH, CKPT_PATH, nullptr, TAIL_CHUNK, 1048576);
+    tailer->init(callback);
+    tailer->run();
+    wait_for(total);
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "catch-up: " << received << " lines, " << received / sec << " lines/s, "
+    << bytes / sec / 1048576 << " MB/s" << std::endl;
+
+    //follow, then logrotate (rename + create)
+    append(LOG_PATH, 1000);
+    wait_for(total + 1000);
+    rename(LOG_PATH, LOG_PATH ".1");
+    append(LOG_PATH ".1", 500); //nginx has not reopened yet
+    append(LOG_PATH, 2000);
+    wait_for(total + 3500);
+    std::cout << "after rotation: " << received << " / " << total + 3500 << std::endl;
+    delete tailer;
+
+    //restart, resume from the checkpoint
+    append(LOG_PATH, 100);
+    tailer = new LogTailer(LOG_PATH, CKPT_PATH);
+    tailer->init(callback);
+    tailer->run();
+    wait_for(total + 3600);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    tailer->stop();
+    std::cout << "after restart: " << received << " / " << total + 3600
+    << ", broken: " << broken << ", oversized: " << tailer->oversized() << std::endl;
+    delete tailer;
+
+    unlink(LOG_PATH);
+    unlink(CKPT_PATH);
+    unlink(LOG_PATH ".1");
+    return received == total + 3600 && broken == 0 ? 0 : 1;
+}
@@ -0,0 +1,76 @@
+#include "md5.h"
+#include "cache_path.h"
+#include <chrono>
+#include <iostream>
+#include <random>
+
+//usage: md5_test [keys]
+//build with -mavx2 for 8 lanes (4 with SSE2)
+
+int main(int argc, char** argv){
+    size_t count = argc > 1 ? std::stoull(argv[1]) : 1000000;
+    size_t failed = 0;
+
+    //RFC 1321
+    std::vector<std::pair<std::string, std::string>> vectors = {
+        {"", "d41d8cd98f00b204e9800998ecf8427e"},
+        {"a", "0cc175b9c0f1b6a831c399e269772661"},
+        {"abc", "900150983cd24fb0d6963f7d28e17f72"},
+        {"message digest", "f96b697d7cb7938d525a2f31aaf161d0"},
+        {"abcdefghijklmnopqrstuvwxyz", "c3fcd3d76192e4007dfb496cca67e13b"},
+        {"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789", "d174ab98d277d9f5a5611c2c9f419d9f"},
+        {"12345678901234567890123456789012345678901234567890123456789012345678901234567890", "57edf4a22be3c955ac49da2e2107b67a"}
+    };
+    for(auto& [in, hex] : vectors){
+        if(md5_hex(md5(in)) != hex){
+            std::cerr << "md5 mismatch: \"" << in << "\"" << std::endl;
+            failed++;
+        }
+    }
+
+    //the batch must agree with the scalar version, across block boundaries
+    std::mt19937 rng(42);
+    std::vector<std::string> keys;
+    for(size_t i = 0; i < count; i++){
+        size_t len = i < 200 ? i : 20 + rng() % 100;
+        std::string key = "https://pypi.org/packages/";
+        key.resize(len, 'x');
+        for(auto& c : key)if(c == 'x')c = 'a' + rng() % 26;
+        keys.push_back(key);
+    }
+    std::vector<std::string_view> views(keys.begin(), keys.end());
+    std::vector<Md5Digest> batch;
+
+    auto start = std::chrono::steady_clock::now();
+    md5_batch(views, batch);
+    double batch_sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    size_t mismatch = 0;
+    start = std::chrono::steady_clock::now();
+    for(size_t i = 0; i < count; i++)if(md5(views[i]) != batch[i])mismatch++;
+    double scalar_sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if(mismatch){
+        std::cerr << "batch mismatch: " << mismatch << std::endl;
+        failed++;
+    }
+    std::cout << "scalar: " << count / scalar_sec << " keys/s, batch (" << md5_lanes() << " lanes): "
+    << count / batch_sec << " keys/s" << std::endl;
+
+    CachePath cache_path("/data/nginx/cache", "1:2");
+    Md5Digest digest;
+    std::string hex = "b7f54b2df7773722d382f4809d65029c";
+    for(size_t i = 0; i < 16; i++)digest[i] = std::stoi(hex.substr(i * 2, 2), nullptr, 16);
+    if(cache_path.path(digest) != "/data/nginx/cache/c/29/b7f54b2df7773722d382f4809d65029c"){
+        std::cerr << "cache path mismatch: " << cache_path.path(digest) << std::endl;
+        failed++;
+    }
+    if(CachePath("/cache/", "2").path(digest) != "/cache/9c/b7f54b2df7773722d382f4809d65029c"){
+        failed++;
+    }
+    std::vector<std::string> paths;
+    cache_path.paths(std::span(views).first(8), paths);
+    for(size_t i = 0; i < 8; i++)if(paths[i] != cache_path.path(views[i]))failed++;
+
+    std::cout << (failed ? "FAILED" : "ok") << std::endl;
+    return failed ? 1 : 0;
+}
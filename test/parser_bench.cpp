@@ -0,0 +1,204 @@
+#include "parser.h"
+#include "parser_projection.h"
+#include "parser_simd.h"
+#include "parser_delimited.h"
+#include "prefilter.h"
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <random>
+
+//usage: parser_bench [recorded log, one JSON per line, "" for generated] [rounds]
+//build with -DUSE_SIMDJSON -march=native to include the simdjson backend
+
+std::vector<std::string> keys = {"time", "remote_addr", "request", "status", "upstream_cache_status",
+                                 "body_bytes_sent", "request_time", "http_user_agent"};
+
+std::vector<std::string> make_lines(size_t count){
+    std::mt19937 rng(42);
+    std::vector<std::string> lines;
+    for(size_t i = 0; i < count; i++){
+        std::string pkg = "pkg" + std::to_string(rng() % 5000);
+        lines.push_back(R"({"time":"2025-01-01T00:00:)" + std::to_string(10 + i % 50) +
+        R"(+00:00","remote_addr":"10.0.)" + std::to_string(rng() % 256) + "." + std::to_string(rng() % 256) +
+        R"(","request":"GET /packages/)" + pkg + "/" + pkg + "-1." + std::to_string(rng() % 20) +
+        R"(-py3-none-any.whl?sha256=)" + std::to_string(rng()) + std::to_string(rng()) +
+        R"( HTTP/1.1","status":200,"upstream_cache_status":")" + (rng() % 4 ? "HIT" : "MISS") +
+        R"(","body_bytes_sent":)" + std::to_string(rng() % 50000000) +
+        R"(,"request_time":0.)" + std::to_string(rng() % 1000) +
+        R"(,"http_referer":"","http_user_agent":"pip/24.0 {\"ci\":null,\"cpu\":\"x86_64\",\"python\":\"3.12.1\"}",)" +
+        R"("server_name":"pypi.mirror.example","scheme":"https","ssl_protocol":"TLSv1.3"})");
+    }
+    return lines;
+}
+
+//the same records in a \x1f-separated log_format (fields in the order of keys)
+std::vector<std::string> to_delimited(const std::vector<std::string>& lines){
+    ProjectionParser projection(keys);
+    std::vector<std::string> out;
+    std::vector<Parser::LogValue> values;
+    for(auto& it : lines){
+        projection.parse(it, values);
+        std::string line;
+        for(size_t i = 0; i < values.size(); i++){
+            if(i)line += DEFAULT_DELIMITER;
+            std::visit([&](const auto& v){
+                using T = std::decay_t<decltype(v)>;
+                if constexpr(std::is_same_v<T, std::string>)line += v;
+                else if constexpr(std::is_same_v<T, int64_t> || std::is_same_v<T, uint64_t>)line += std::to_string(v);
+                else if constexpr(std::is_same_v<T, double>){
+                    char buf[32];
+                    line.append(buf, std::to_chars(buf, buf + sizeof(buf), v, std::chars_format::fixed, 3).ptr);
+                }
+                else line += "-";
+            }, values[i]);
+        }
+        out.push_back(line);
+    }
+    return out;
+}
+
+bool same(const Parser::LogValue& a, const Parser::LogValue& b){
+    if(a.index() != b.index())return false;
+    if(auto *ua = std::get_if<Parser::UnknownType>(&a)){
+        auto *ub = std::get_if<Parser::UnknownType>(&b);
+        return ua->exist == ub->exist && (!ua->exist || ua->value == ub->value);
+    }
+    return std::visit([&](const auto& va){
+        using T = std::decay_t<decltype(va)>;
+        if constexpr(std::is_same_v<T, Parser::UnknownType>)return true;
+        else return va == std::get<T>(b);
+    }, a);
+}
+
+void bench(const std::string& name, const std::vector<std::string>& lines, size_t rounds, size_t bytes,
+           const std::function<void(std::string_view, std::vector<Parser::LogValue>&)>& parse){
+    std::vector<Parser::LogValue> values;
+    size_t failed = 0;
+    auto start = std::chrono::steady_clock::now();
+    for(size_t r = 0; r < rounds; r++){
+        for(auto& it : lines){
+            try{
+                parse(it, values);
+            }catch(const std::exception& e){
+                failed++;
+            }
+        }
+    }
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << name << ": " << lines.size() * rounds / sec << " lines/s, "
+    << bytes * rounds / sec / 1048576 << " MB/s, failed: " << failed << std::endl;
+}
+
+int main(int argc, char** argv){
+    std::vector<std::string> lines;
+    if(argc > 1 && argv[1][0]){
+        std::ifstream in(argv[1]);
+        for(std::string line; std::getline(in, line);)if(line.size())lines.push_back(line);
+    }else{
+        lines = make_lines(100000);
+    }
+    size_t rounds = argc > 2 ? std::stoull(argv[2]) : 10;
+    if(lines.empty()){
+        std::cerr << "no input" << std::endl;
+        return 1;
+    }
+    size_t bytes = 0;
+    for(auto& it : lines)bytes += it.size();
+    std::cout << lines.size() << " lines, " << bytes / lines.size() << " bytes/line" << std::endl;
+
+    Parser dom(keys);
+    ProjectionParser projection(keys);
+
+#ifdef USE_SIMDJSON
+    SimdParser simd(keys);
+    std::string joined;
+    for(auto& it : lines)joined += it + "\n";
+#endif
+
+    size_t mismatch = 0;
+    for(auto& it : lines){
+        std::vector<Parser::LogValue> a, b;
+        try{
+            dom.parse(it, a);
+        }catch(const std::exception& e){
+            continue;
+        }
+        projection.parse(it, b);
+        for(size_t i = 0; i < keys.size(); i++){
+            if(!same(a[i], b[i])){
+                if(mismatch++ < 5)std::cerr << "mismatch on key " << keys[i] << ": " << it << std::endl;
+            }
+        }
+#ifdef USE_SIMDJSON
+        simd.parse(it, b);
+        for(size_t i = 0; i < keys.size(); i++){
+            if(!same(a[i], b[i])){
+                if(mismatch++ < 5)std::cerr << "simdjson mismatch on key " << keys[i] << ": " << it << std::endl;
+            }
+        }
+#endif
+    }
+    std::cout << "mismatches: " << mismatch << std::endl;
+
+    bench("nlohmann  ", lines, rounds, bytes, [&](std::string_view data, std::vector<Parser::LogValue>& v){
+        dom.parse(data, v);
+    });
+    bench("projection", lines, rounds, bytes, [&](std::string_view data, std::vector<Parser::LogValue>& v){
+        projection.parse(data, v);
+    });
+    auto delimited = to_delimited(lines);
+    size_t delimited_bytes = 0;
+    for(auto& it : delimited)delimited_bytes += it.size();
+    DelimitedParser tsv(keys);
+    size_t tsv_mismatch = 0;
+    for(size_t n = 0; n < lines.size(); n++){
+        std::vector<Parser::LogValue> a, b;
+        projection.parse(lines[n], a);
+        tsv.parse(delimited[n], b);
+        for(size_t i = 0; i < keys.size(); i++){
+            if(!same(a[i], b[i]) && tsv_mismatch++ < 5){
+                std::cerr << "delimited mismatch on key " << keys[i] << ": " << delimited[n] << std::endl;
+            }
+        }
+    }
+    std::cout << "delimited mismatches: " << tsv_mismatch << " (" << delimited_bytes / lines.size()
+    << " bytes/line)" << std::endl;
+    bench("delimited ", delimited, rounds, delimited_bytes, [&](std::string_view data, std::vector<Parser::LogValue>& v){
+        tsv.parse(data, v);
+    });
+    std::vector<std::string_view> fields;
+    bench("delimited (views)", delimited, rounds, delimited_bytes, [&](std::string_view data, std::vector<Parser::LogValue>& v){
+        tsv.parse_views(data, fields);
+    });
+
+    //only the lines the policy cares about reach the parser
+    Prefilter::Rules rules;
+    rules.cache_status = {"MISS"};
+    rules.methods = {"GET"};
+    rules.uri_exclude = {"/simple/"};
+    Prefilter prefilter(rules);
+    bench("prefilter + projection", lines, rounds, bytes, [&](std::string_view data, std::vector<Parser::LogValue>& v){
+        if(prefilter.pass(data))projection.parse(data, v);
+    });
+    auto counts = prefilter.counters();
+    for(int i = 0; i < Prefilter::REASON_NUM; i++){
+        std::cout << "  " << Prefilter::reason_name(i) << ": " << counts[i] / rounds << std::endl;
+    }
+
+#ifdef USE_SIMDJSON
+    bench("simdjson  ", lines, rounds, bytes, [&](std::string_view data, std::vector<Parser::LogValue>& v){
+        simd.parse(data, v);
+    });
+
+    size_t parsed = 0, broken = 0;
+    auto start = std::chrono::steady_clock::now();
+    for(size_t r = 0; r < rounds; r++){
+        broken += simd.parse_many(joined, [&](std::vector<Parser::LogValue>& v){parsed++;});
+    }
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "simdjson (iterate_many): " << parsed / sec << " lines/s, "
+    << joined.size() * rounds / sec / 1048576 << " MB/s, failed: " << broken << std::endl;
+#endif
+    return 0;
+}
@@ -0,0 +1,64 @@
+#include "buffer_pool.h"
+#include "pipeline_stage.h"
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#define MESSAGES 200000
+
+template<typename T>
+void print_stats(const Stage<T>& stage){
+    auto st = stage.stats();
+    std::cout << stage.stage_name() << ": depth " << st.depth << "/" << st.capacity
+    << ", pushed " << st.pushed << ", processed " << st.processed
+    << ", dropped " << st.dropped << ", avg " << st.avg_us() << "us"
+    << ", max " << st.max_ns / 1000 << "us, blocked " << st.blocked_ns / 1000000 << "ms" << std::endl;
+}
+
+int main(int argc, char** argv){
+    int overflow = argc > 1 ? std::stoi(argv[1]) : Stage<int>::OVERFLOW_DROP_OLDEST;
+    BufferPool pool(4096, 256);
+    size_t committed = 0;
+
+    //policy: slow every 1000 items, like a SQLite commit
+    Stage<std::vector<std::string>> policy("policy", [&](std::vector<std::string>& values){
+        if(++committed % 1000 == 0)std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }, 1024, overflow);
+
+    //parser: split the fields, the lease goes back to the pool afterwards
+    Stage<BufferPool::Lease> parser("parser", [&](BufferPool::Lease& lease){
+        std::vector<std::string> values;
+        auto msg = lease.view();
+        size_t pos = 0, next;
+        while((next = msg.find(' ', pos)) != std::string_view::npos){
+            values.emplace_back(msg.substr(pos, next - pos));
+            pos = next + 1;
+        }
+        values.emplace_back(msg.substr(pos));
+        policy.push(std::move(values));
+    }, 1024, overflow);
+
+    policy.run();
+    parser.run();
+
+    //receiver
+    size_t exhausted = 0;
+    for(size_t i = 0; i < MESSAGES; i++){
+        auto lease = pool.acquire();
+        if(!lease){
+            exhausted++;
+            continue;
+        }
+        lease.set_size(snprintf(lease.data(), lease.capacity(), "GET /simple/pkg%zu/ 200 %zu", i, i * 7));
+        parser.push(std::move(lease));
+    }
+
+    parser.stop();
+    policy.stop();
+    print_stats(parser);
+    print_stats(policy);
+    std::cout << "pool exhausted: " << exhausted << ", committed: " << committed
+    << ", pool free: " << pool.available() << "/" << pool.size() << std::endl;
+    return 0;
+}
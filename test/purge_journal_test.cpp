@@ -0,0 +1,80 @@
+#include "purge_journal.h"
+#include <iostream>
+#include <sys/wait.h>
+
+#define JOURNAL_PATH "/tmp/x_cache_manager_purge.journal"
+
+std::string path_of(size_t i){
+    return "/packages/pkg" + std::to_string(i) + "/pkg" + std::to_string(i) + "-1.0-py3-none-any.whl";
+}
+
+int main(){
+    size_t failed = 0;
+    unlink(JOURNAL_PATH);
+
+    //a crashed run: 1000 added, 400 done, synced, then killed
+    pid_t pid = fork();
+    if(pid == 0){
+        PurgeJournal journal(JOURNAL_PATH);
+        journal.replay();
+        for(size_t i = 0; i < 1000; i++)journal.add(path_of(i));
+        for(size_t i = 0; i < 400; i++)journal.done(path_of(i));
+        journal.sync();
+        journal.add(path_of(5000)); //not synced, survives a process crash (page cache)
+        _exit(0);
+    }
+    waitpid(pid, nullptr, 0);
+
+    {
+        PurgeJournal journal(JOURNAL_PATH);
+        auto pending = journal.replay();
+        std::cout << "replayed: " << pending.size() << " / 601" << std::endl;
+        if(pending.size() != 601)failed++;
+        for(auto& it : pending)journal.done(it);
+        journal.sync();                                 //drained, new epoch
+        if(journal.size() != 8 || journal.pending())failed++;
+        journal.add(path_of(7));
+    }
+
+    //torn tail: a record cut in the middle is ignored
+    {
+        PurgeJournal journal(JOURNAL_PATH);
+        auto pending = journal.replay();
+        if(pending.size() != 1 || pending[0] != path_of(7))failed++;
+        size_t end = journal.size();
+        journal.add(path_of(8));
+        journal.sync();
+        int fd = open(JOURNAL_PATH, O_WRONLY);
+        char garbage[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+        if(pwrite(fd, garbage, sizeof(garbage), end + 12) != sizeof(garbage))failed++;
+        close(fd);
+    }
+    {
+        PurgeJournal journal(JOURNAL_PATH);
+        auto pending = journal.replay();
+        std::cout << "after torn record: " << pending.size() << " / 1" << std::endl;
+        if(pending.size() != 1)failed++;
+    }
+
+    //compaction: the file is rewritten with the pending paths only (path 7 is still there)
+    {
+        PurgeJournal journal(JOURNAL_PATH, JOURNAL_GROW);
+        journal.replay();
+        for(size_t i = 0; i < 100000; i++){
+            journal.add(path_of(i));
+            if(i >= 10)journal.done(path_of(i));
+            if(i % 1000 == 0)journal.sync();
+        }
+        journal.sync();
+        std::cout << "compacted size: " << journal.size() << ", pending: " << journal.pending() << std::endl;
+        if(journal.size() > JOURNAL_GROW || journal.pending() != 10)failed++;
+    }
+    {
+        PurgeJournal journal(JOURNAL_PATH);
+        if(journal.replay().size() != 10)failed++;
+    }
+
+    unlink(JOURNAL_PATH);
+    std::cout << (failed ? "FAILED" : "ok") << std::endl;
+    return failed ? 1 : 0;
+}
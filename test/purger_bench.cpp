@@ -0,0 +1,163 @@
+#include "purger.h"
+#include <cstring>
+#include <map>
+#include <set>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+//usage: purger_bench [requests] [inflight_max] [server delay, ms] [target latency, ms, 0: no rate control]
+//a stand-in for nginx + ngx_cache_purge on 127.0.0.1: keep-alive, answers
+//"Key: ..." after the delay, and 404 to the first try of every 100th path (retried);
+//every 10th add repeats an earlier path, collapsed unless it was already purged;
+//the delay grows by 0.1ms per request waiting in the server (load)
+
+std::atomic<bool> server_stop = 0;
+std::atomic<size_t> server_requests = 0, server_conns = 0;
+
+void serve(int listen_fd, int delay){
+    struct Conn{
+        std::string in;
+        std::vector<std::chrono::steady_clock::time_point> due; //one per pending response
+        std::vector<bool> found;
+    };
+    std::map<int, Conn> conns;
+    std::set<std::string> missed;
+    std::vector<pollfd> fds;
+    char buf[65536];
+    size_t outstanding = 0;
+    while(!server_stop){
+        auto now = std::chrono::steady_clock::now();
+        int wait = 10;
+        for(auto& [fd, c] : conns){
+            size_t sent = 0;
+            while(sent < c.due.size() && c.due[sent] <= now){
+                std::string key = "Key: /packages/x\n";
+                std::string resp = c.found[sent] ? "HTTP/1.1 200 OK\r\nContent-Length: " + std::to_string(key.size()) + "\r\n\r\n" + key
+                                                 : "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n";
+                send(fd, resp.data(), resp.size(), MSG_NOSIGNAL);
+                sent++;
+            }
+            outstanding -= sent;
+            c.due.erase(c.due.begin(), c.due.begin() + sent);
+            c.found.erase(c.found.begin(), c.found.begin() + sent);
+            if(c.due.size()){
+                wait = std::min<int>(wait, std::chrono::duration_cast<std::chrono::milliseconds>(c.due.front() - now).count());
+            }
+        }
+        fds.clear();
+        fds.push_back({listen_fd, POLLIN, 0});
+        for(auto& [fd, c] : conns)fds.push_back({fd, POLLIN, 0});
+        poll(fds.data(), fds.size(), std::max(wait, 0));
+        if(fds[0].revents & POLLIN){
+            int fd = accept(listen_fd, nullptr, nullptr);
+            if(fd >= 0){
+                int one = 1;
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+                conns[fd];
+                server_conns++;
+            }
+        }
+        for(size_t i = 1; i < fds.size(); i++){
+            if(!fds[i].revents)continue;
+            int fd = fds[i].fd;
+            ssize_t len = recv(fd, buf, sizeof(buf), 0);
+            if(len <= 0){
+                outstanding -= conns[fd].due.size();
+                close(fd);
+                conns.erase(fd);
+                continue;
+            }
+            auto& c = conns[fd];
+            c.in.append(buf, len);
+            size_t pos;
+            while((pos = c.in.find("\r\n\r\n")) != std::string::npos){
+                std::string path = c.in.substr(0, c.in.find(' ', c.in.find(' ') + 1));
+                c.in.erase(0, pos + 4);
+                server_requests++;
+                bool found = path.size() < 6 || std::stoul(path.substr(path.find("pkg") + 3)) % 100 ||
+                             !missed.insert(path).second;
+                c.due.push_back(std::chrono::steady_clock::now() + std::chrono::microseconds(delay * 1000 + outstanding * 100));
+                outstanding++;
+                c.found.push_back(found);
+            }
+        }
+    }
+    for(auto& [fd, c] : conns)close(fd);
+}
+
+int main(int argc, char** argv){
+    size_t total = argc > 1 ? std::stoull(argv[1]) : 20000;
+    int inflight_max = argc > 2 ? std::stoi(argv[2]) : INFLIGHT_MAX;
+    int delay = argc > 3 ? std::stoi(argv[3]) : 5;
+    double target = argc > 4 ? std::stod(argv[4]) : 0;
+
+    int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addr_len = sizeof(addr);
+    if(bind(listen_fd, (sockaddr*)&addr, sizeof(addr)) || listen(listen_fd, 1024) ||
+       getsockname(listen_fd, (sockaddr*)&addr, &addr_len)){
+        std::cerr << "listen: " << strerror(errno) << std::endl;
+        return 1;
+    }
+    std::thread server(serve, listen_fd, delay);
+
+    std::atomic<size_t> fails = 0;
+    unlink("/tmp/x_cache_manager_purger_bench.journal");
+    std::shared_ptr<RateController> controller;
+    if(target > 0){
+        RateController::Options opt;
+        opt.target_latency = target;
+        controller = std::make_shared<RateController>(opt);
+    }
+    auto journal = std::make_shared<PurgeJournal>("/tmp/x_cache_manager_purger_bench.journal");
+    Purger purger([&](const std::string path, int tries){fails++;},
+                  "http://127.0.0.1:" + std::to_string(ntohs(addr.sin_port)),
+                  DEFAULT_CMD, total, inflight_max, TRY_MAX, TIMEOUT, journal, controller);
+
+    size_t dups = 0;
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::string> batch;
+    for(size_t i = 0; i < total; i++){
+        if(i % 2){  //half one by one, half in eviction-sized batches
+            while(!purger.add("/packages/pkg" + std::to_string(i) + ".whl")){
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }else{
+            batch.push_back("/packages/pkg" + std::to_string(i) + ".whl");
+        }
+        if(i % 10 == 0){    //an earlier path again
+            batch.push_back("packages/pkg" + std::to_string(i / 2) + ".whl");
+            dups++;
+        }
+        if(batch.size() >= 128 || i + 1 == total){
+            size_t accepted = purger.add_batch(batch);
+            if(accepted < batch.size())std::cerr << "batch not accepted" << std::endl;
+            batch.clear();
+        }
+    }
+    while(purger.succeeded() + purger.failed() + purger.collapsed() < total + dups &&
+          std::chrono::steady_clock::now() - start < std::chrono::seconds(120)){
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    purger.stop();
+    if(controller){
+        std::cout << "rate control: target " << target << "ms, window " << controller->window()
+        << ", latency " << controller->latency() << "ms, backoffs " << controller->backoffs() << std::endl;
+    }
+    server_stop = true;
+    server.join();
+    close(listen_fd);
+
+    std::cout << "inflight_max " << inflight_max << ", delay " << delay << "ms: "
+    << total / sec << " purges/s, succeeded: " << purger.succeeded() << ", failed: " << purger.failed()
+    << ", collapsed: " << purger.collapsed() << ", server requests: " << server_requests
+    << ", connections: " << server_conns << ", journal pending: " << journal->pending() << std::endl;
+    unlink("/tmp/x_cache_manager_purger_bench.journal");
+    return purger.succeeded() + purger.collapsed() == total + dups && journal->pending() == 0 ? 0 : 1;
+}
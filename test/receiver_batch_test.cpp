@@ -0,0 +1,50 @@
+#include "receiver.h"
+#include <sys/un.h>
+#include <unistd.h>
+#include <cstring>
+
+#define SOCK_PATH "/tmp/x_cache_manager_test.sock"
+
+std::atomic<size_t> received = 0, batches = 0, bytes = 0;
+
+void callback(std::span<std::string_view> batch){
+    batches++;
+    received += batch.size();
+    for(auto it : batch)bytes += it.size();
+}
+
+int main(int argc, char** argv){
+    if(argc < 3){
+        std::cerr << "usage: " << argv[0] << " <owner> <group> [messages]" << std::endl;
+        return 1;
+    }
+    size_t total = argc > 3 ? std::stoull(argv[3]) : 100000;
+
+    Receiver* recv = new Receiver(SOCK_PATH, argv[1], argv[2], 0660);
+    recv->init_batch(callback);
+    recv->io_run();
+    recv->receive_start();
+
+    int fd = socket(AF_UNIX, SOCK_DGRAM, 0);
+    sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, SOCK_PATH, sizeof(addr.sun_path) - 1);
+    
+    std::string msg = R"({"time":"2025-01-01T00:00:00+00:00","request":"GET /packages/foo.whl HTTP/1.1","status":200})";
+    auto start = std::chrono::steady_clock::now();
+    for(size_t i = 0; i < total; i++){
+        while(sendto(fd, msg.data(), msg.size(), 0, (sockaddr*)&addr, sizeof(addr)) < 0){
+            std::this_thread::yield(); //queue full, retry (nginx would drop it)
+        }
+    }
+    while(received < total)std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "received: " << received << " in " << batches << " batches, "
+    << received / sec << " msg/s, " << bytes / sec / 1048576 << " MB/s" << std::endl;
+    
+    close(fd);
+    recv->receive_stop();
+    delete recv;
+    return 0;
+}
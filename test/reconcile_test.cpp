@@ -0,0 +1,95 @@
+#include "reconciler.h"
+#include "algo_lru_sqlite.h"
+#include <fstream>
+
+//usage: reconcile_test [files] [directory]
+//a cache tree and an LRU database that disagree: rows with the wrong
+//size, rows without a file, files without a row (with and without a key
+//in the header) and a variant; after reconcile() init() must pass and
+//cache_size must be the bytes on disk
+
+std::string root = "/tmp/x_cache_manager_reconcile_test";
+const std::string prefix = "https://pypi.org";
+
+uint64_t create(const CachePath& cache_path, const std::string& key, size_t size, bool with_key = true){
+    std::string file = cache_path.path(cache_key(prefix, key));
+    fs::create_directories(fs::path(file).parent_path());
+    std::ofstream out(file);
+    out << std::string(64, '\0');
+    if(with_key)out << "\nKEY: " << cache_key(prefix, key) << "\n";
+    out << std::string(size, 'x');
+    out.close();
+    struct stat st;
+    stat(file.c_str(), &st);
+    return st.st_blocks * 512;
+}
+
+void callback(std::vector<LRU::Cache>&& removed){}
+
+int main(int argc, char** argv){
+    size_t count = argc > 1 ? std::stoull(argv[1]) : 20000;
+    if(argc > 2)root = std::string(argv[2]) + "/x_cache_manager_reconcile_test";
+    fs::remove_all(root);
+    fs::create_directories(root + "/db");
+    CachePath cache_path(root + "/cache", "1:2");
+    fs::create_directories(cache_path.root());
+
+    auto db = std::make_shared<SQLiteLRU>(root + "/db", "cache.db");
+    db->insert_meta({0, 1ULL << 40, 0});
+    size_t resized = count / 10, phantoms = count / 10, untracked = count / 10, unreadable = 10;
+    uint64_t disk = 0, rows_size = 0;
+    int64_t sequence = 0;
+    db->begin();
+    for(size_t i = 0; i < count; i++){
+        std::string key = "/packages/pkg" + std::to_string(i) + ".whl";
+        uint64_t size = 4096;                  //phantom: no file
+        if(i >= phantoms){
+            size = create(cache_path, key, 1000 + i % 100000);
+            disk += size;
+        }
+        if(i >= phantoms && i < phantoms + resized)size = 1000;      //the size from the log
+        rows_size += size;
+        db->insert_lru({key, size, 0, {}, ++sequence});
+    }
+    db->commit();
+    db->update_meta({rows_size, 1ULL << 40, sequence});
+    for(size_t i = 0; i < untracked; i++)disk += create(cache_path, "/untracked/" + std::to_string(i), 5000);
+    for(size_t i = 0; i < unreadable; i++)create(cache_path, "/unreadable/" + std::to_string(i), 5000, false);
+    create(cache_path, "/variant", 5000);
+    std::string variant = cache_path.path(cache_key(prefix, "/variant"));
+    rename(variant.c_str(), (variant + ".0000000001").c_str());
+
+    std::vector<Reconciler::Row> rows;
+    for(auto& [key, size] : db->query_lru_keys())rows.push_back({key, size});
+    Reconciler reconciler(cache_path, prefix);
+    auto diff = reconciler.run(rows);
+    std::cout << diff.files << " files, " << rows.size() << " rows in " << diff.seconds << "s, "
+    << diff.files / diff.seconds << " files/s" << std::endl;
+    bool ok = diff.phantoms.size() == phantoms && diff.resized.size() == resized &&
+              diff.untracked.size() == untracked && diff.unreadable == unreadable;
+
+    std::vector<std::pair<std::string, size_t>> sizes;
+    for(auto& it : diff.resized)sizes.push_back({it.key, it.size});
+    std::vector<LRU::Cache> added;
+    for(auto& it : diff.untracked)added.push_back({it.key, it.size, static_cast<uint64_t>(it.mtime), {}});
+    {
+        LRU lru(db, callback);
+        lru.reconcile(diff.phantoms, sizes, added);
+        lru.init();
+        auto meta = db->query_meta();
+        std::cout << "cache_size: " << meta.cache_size << " / " << disk << std::endl;
+        ok &= meta.cache_size == disk;
+        //the untracked files are the first to go
+        ok &= db->query_lru_old().key.starts_with("/untracked/");
+    }
+
+    auto again = reconciler.run([&]{
+        std::vector<Reconciler::Row> res;
+        for(auto& [key, size] : db->query_lru_keys())res.push_back({key, size});
+        return res;
+    }());
+    ok &= again.phantoms.empty() && again.resized.empty() && again.untracked.empty();
+
+    fs::remove_all(root);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,70 @@
+#include "db_redis_lru.h"
+#include "redis_subscriber.h"
+#include "redis_evict_batcher.h"
+#include "purger.h"
+#include "logger.h"
+#include "logging_zones.h"
+#include <chrono>
+#include <memory>
+#include <thread>
+
+std::shared_ptr<Logger> logger = std::make_shared<Logger>();
+
+void purge_fail(const std::string path, int tries){
+    logger->put_error(LOG_ZONE_PURGER, "purge failed: ", path, ", tries: ", tries);
+}
+
+void sub_cb(SubManager::Reply reply){
+    if(auto *ptr = std::get_if<SubManager::RedisReplyError>(&reply)){
+        logger->put_debug(LOG_ZONE_MAIN, "error from callback: ", ptr->str);
+    }
+}
+
+int main(){
+    logger->setup(Logger::LOG_LOGGER_STDOUT);
+    logger->set_level(Logger::LOG_TYPE_CONSOLE, Logger::LOG_LEVEL_DEBUG);
+
+    auto redis = std::make_shared<RedisAdapter>(logger, "127.0.0.1", 6379, "127.0.0.1",
+                                                1000, 1000, 30000, 200, 2, true);
+    redis->init();
+    RedisLRU db_redis(logger, redis);
+    Purger purger(purge_fail);
+
+    EvictBatcher batcher([&](std::span<std::string> keys){
+        auto removed = db_redis.delete_lru_evicted(keys);
+        size_t freed = 0;
+        std::vector<std::string> paths;
+        paths.reserve(removed.size());
+        for(auto& it : removed){
+            freed += it.size;
+            paths.push_back(std::move(it.key));
+        }
+        purger.add_batch(paths);
+        logger->put_info(LOG_ZONE_MAIN, "batch: ", keys.size(), " evicted, ",
+                         removed.size(), " reconciled, freed: ", freed);
+    }, logger, 128, 50);
+    batcher.run();
+
+    SubManager* manager = new SubManager(sub_cb, logger, "127.0.0.1");
+    manager->set_message_callback([&](std::string_view channel, std::string_view msg){
+        batcher.on_message(channel, msg);
+    });
+    manager->init();
+    std::thread thr([manager]{
+            manager->connect();
+            logger->put_debug(LOG_ZONE_MAIN, "connection thread exit");
+            });
+    thr.detach();
+    while(manager->status != 1){
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    logger->put_info(LOG_ZONE_MAIN, "sub status: ", manager->subscribe());
+    std::this_thread::sleep_for(std::chrono::milliseconds(40000));
+    manager->uninit();
+    delete manager;
+
+    batcher.stop();
+    logger->put_info(LOG_ZONE_MAIN, "total flushed: ", batcher.flushed());
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    return 0;
+}
@@ -0,0 +1,41 @@
+#include "db_redis_warmup.h"
+#include "logger.h"
+#include "logging_zones.h"
+#include <bit>
+#include <map>
+#include <memory>
+#include <mutex>
+
+int main(int argc, char** argv){
+    std::shared_ptr<Logger> logger = std::make_shared<Logger>();
+    logger->setup(Logger::LOG_LOGGER_STDOUT);
+    logger->set_level(Logger::LOG_TYPE_CONSOLE, Logger::LOG_LEVEL_DEBUG);
+
+    auto factory = [logger]{
+        auto redis = std::make_shared<RedisAdapter>(logger, "127.0.0.1", 6379, "127.0.0.1",
+                                                    1000, 5000, 30000, 200, 2, true);
+        redis->init();
+        return redis;
+    };
+
+    std::vector<std::string> patterns;
+    for(int i = 1; i < argc; i++)patterns.emplace_back(argv[i]);
+    if(patterns.empty())patterns.emplace_back("*");
+
+    std::mutex hist_lock;
+    std::map<int, size_t> histogram; //log2(size) -> count
+    RedisWarmUp warm_up(logger, factory, patterns, 4, 1000);
+    auto report = warm_up.run([&](std::vector<RedisWarmUp::Cache>& batch){
+        std::map<int, size_t> local;
+        for(auto& it : batch)local[std::bit_width(it.size)]++;
+        std::lock_guard<std::mutex> lock(hist_lock);
+        for(auto& it : local)histogram[it.first] += it.second;
+    });
+
+    for(auto& it : histogram){
+        logger->put_info(LOG_ZONE_MAIN, "size < 2^", it.first, ": ", it.second);
+    }
+    logger->put_info(LOG_ZONE_MAIN, "entries: ", report.entries, ", total size: ",
+                     report.total_size, ", verified: ", warm_up.verify(factory(), report));
+    return 0;
+}
@@ -0,0 +1,61 @@
+#include "buffer_pool.h"
+#include "ring_queue.h"
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define PRODUCERS 4
+#define MESSAGES  1000000
+
+int main(){
+    BufferPool pool(1024, 256);
+    RingQueue<BufferPool::Lease> queue(512);
+    std::atomic<size_t> full = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> producers;
+    for(int p = 0; p < PRODUCERS; p++){
+        producers.emplace_back([&, p]{
+            for(size_t i = 0; i < MESSAGES; i++){
+                BufferPool::Lease lease;
+                while(!(lease = pool.acquire()))std::this_thread::yield();
+                int len = snprintf(lease.data(), lease.capacity(), "%d:%zu", p, i);
+                lease.set_size(len);
+                while(!queue.try_push(std::move(lease))){
+                    full++;
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    size_t popped = 0, bytes = 0;
+    std::vector<size_t> last(PRODUCERS, 0);
+    BufferPool::Lease lease;
+    while(popped < PRODUCERS * MESSAGES){
+        if(!queue.try_pop(lease)){
+            std::this_thread::yield();
+            continue;
+        }
+        auto msg = lease.view();
+        int p = msg[0] - '0';
+        size_t seq = std::stoull(std::string(msg.substr(2)));
+        assert(seq == 0 || seq == last[p] + 1); //per producer FIFO
+        last[p] = seq;
+        bytes += msg.size();
+        lease.release();
+        popped++;
+    }
+    for(auto& it : producers)it.join();
+
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    assert(pool.available() == pool.size());
+    assert(queue.size_approx() == 0);
+    std::cout << "popped: " << popped << ", " << popped / sec << " msg/s, full: " << full
+    << ", pool free: " << pool.available() << "/" << pool.size() << std::endl;
+    return 0;
+}
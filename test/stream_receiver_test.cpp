@@ -0,0 +1,81 @@
+#include "stream_receiver.h"
+#include <sys/un.h>
+#include <unistd.h>
+#include <cstring>
+
+#define SOCK_PATH "/tmp/x_cache_manager_stream_test.sock"
+#define CLIENTS 4
+
+std::atomic<size_t> received = 0, batches = 0, bytes = 0, broken = 0;
+
+void callback(std::span<std::string_view> batch){
+    batches++;
+    received += batch.size();
+    for(auto it : batch){
+        bytes += it.size();
+        if(it.front() != '{' || it.back() != '}')broken++;
+    }
+}
+
+void client(size_t total, bool octet){
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, SOCK_PATH, sizeof(addr.sun_path) - 1);
+    if(connect(fd, (sockaddr*)&addr, sizeof(addr))){
+        std::cerr << "connect: " << std::strerror(errno) << std::endl;
+        return;
+    }
+
+    //a long url (> BUFFER_SIZE of the datagram receiver) wrapped in a syslog header
+    std::string json = R"({"time":"2025-01-01T00:00:00+00:00","request":"GET /packages/foo.whl?)" +
+                       std::string(6000, 'q') + R"( HTTP/1.1","status":200})";
+    std::string msg = "<190>Jan  1 00:00:00 cache nginx: " + json;
+    std::string frame = octet ? std::to_string(msg.size()) + " " + msg : msg + "\n";
+
+    std::string chunk;
+    for(size_t i = 0; i < total; i++){
+        chunk += frame;
+        if(chunk.size() < 65536 && i + 1 < total)continue;
+        for(size_t off = 0; off < chunk.size();){
+            ssize_t res = write(fd, chunk.data() + off, chunk.size() - off);
+            if(res < 0){
+                std::cerr << "write: " << std::strerror(errno) << std::endl;
+                close(fd);
+                return;
+            }
+            off += res;
+        }
+        chunk.clear();
+    }
+    close(fd);
+}
+
+int main(int argc, char** argv){
+    if(argc < 3){
+        std::cerr << "usage: " << argv[0] << " <owner> <group> [messages per client]" << std::endl;
+        return 1;
+    }
+    size_t total = argc > 3 ? std::stoull(argv[3]) : 100000;
+
+    StreamReceiver* recv = new StreamReceiver(SOCK_PATH, argv[1], argv[2], 0660);
+    recv->init(callback);
+    recv->io_run();
+    recv->receive_start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> clients;
+    for(int i = 0; i < CLIENTS; i++)clients.emplace_back(client, total, i % 2);
+    for(auto& it : clients)it.join();
+    while(received < total * CLIENTS)std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "received: " << received << " in " << batches << " batches, broken: " << broken
+    << ", oversized: " << recv->oversized() << ", " << received / sec << " msg/s, "
+    << bytes / sec / 1048576 << " MB/s" << std::endl;
+
+    recv->receive_stop();
+    delete recv;
+    return 0;
+}